@@ -13,28 +13,20 @@
 
 #include "Core/BaseType.h"
 #include "Core/FileSystem.h"
+#include "VulkanBuffer.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanFrameRing.h"
+#include "VulkanPipeline.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanPipelineLog.h"
+#include "VulkanScheduler.h"
+#include "VulkanStagingRing.h"
 #include "VulkanWindow.h"
+#include "Shader/ShaderCache.h"
+#include "Shader/VulkanShader.h"
 
 #undef NDEBUG
 
-// 着色器字节码读取函数
-static std::vector<char> ReadFile(const File::Path& filePath) {
-    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("无法打开文件：" + filePath.string());
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
-}
-
 // Vulkan三角形渲染类
 class TriangleApp {
 public:
@@ -59,20 +51,25 @@ public:
     VkExtent2D swapChainExtent;
     std::vector<VkImageView> swapChainImageViews;
     VkRenderPass renderPass;
-    VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    const VulkanPipeline* graphicsPipeline = nullptr;
+    const VulkanPipeline* pendingPipeline = nullptr;    // 热重载后正在后台编译的管线
+    std::vector<const VulkanPipeline*> supersededPipelines; // 编译完成前就被新的热重载取代的管线
     std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkSemaphore imageAvailableSemaphore;
-    VkSemaphore renderFinishedSemaphore;
-    VkFence inFlightFence;
+    VulkanAllocator allocator;
+    VulkanStagingRing stagingRing;
+    VulkanBuffer vertexBuffer;
+    bool framebufferResized = false;
+    VulkanFrameRing frameRing;              // 每帧的信号量、栅栏和命令缓冲区
+    VulkanFrameAllocator frameAllocator;    // 每帧的uniform和动态顶点数据
+    VulkanScheduler scheduler;              // 时间线提交和延迟销毁
+    ShaderLibrary shaderLibrary;
+    VulkanPipelineCache pipelineCache;
+    VulkanPipelineRegistry pipelineRegistry;
+    VulkanPipelineLog pipelineLog;
 
     const uint32_t WIDTH = 800;
     const uint32_t HEIGHT = 600;
-    const int MAX_FRAMES_IN_FLIGHT = 2;
+    const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
     const std::vector<const char*> validationLayers = {
         "VK_LAYER_KHRONOS_validation"
@@ -145,12 +142,16 @@ public:
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 #if defined(TARGET_NAME)
         window = glfwCreateWindow(WIDTH, HEIGHT, "TARGET_NAME", nullptr, nullptr);
 #else
         window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
 #endif
+        glfwSetWindowUserPointer(window, this);
+        glfwSetFramebufferSizeCallback(window, [](GLFWwindow* resizedWindow, int, int) {
+            static_cast<TriangleApp*>(glfwGetWindowUserPointer(resizedWindow))->framebufferResized = true;
+        });
     }
 
     void InitVulkan() {
@@ -161,40 +162,53 @@ public:
         CreateSwapChain();
         CreateImageViews();
         createRenderPass();
+        PrewarmPipelines();
         CreateGraphicsPipeline();
         CreateFramebuffers();
-        CreateCommandPool();
         CreateVertexBuffer();
-        CreateCommandBuffers();
         CreateSyncObjects();
     }
 
     void MainLoop() {
+        // 修改Asset/Shader下的文件后自动重新编译
+        shaderLibrary.EnableHotReload(CastToProjectPath("Asset/Shader"));
+
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
+            // 帧边界：替换后台编译完成的着色器，新管线在工作线程编译，完成前继续使用旧管线
+            if (!shaderLibrary.ApplyPendingReloads().empty()) {
+                const VulkanPipeline* requested = pipelineRegistry.GetOrCreateAsync(MakePipelineDesc());
+                if (pendingPipeline && pendingPipeline != requested && pendingPipeline != graphicsPipeline) {
+                    supersededPipelines.push_back(pendingPipeline);
+                }
+                pendingPipeline = requested;
+            }
+            ReleaseSupersededPipelines();
+            if (pendingPipeline && pendingPipeline->GetStatus() != VulkanPipelineStatus::Pending) {
+                SwapGraphicsPipeline();
+            }
             DrawFrame();
         }
 
         vkDeviceWaitIdle(device);
+        shaderLibrary.DisableHotReload();
     }
 
-    void cleanup() const
+    void cleanup()
     {
-        vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-        vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-        vkDestroyFence(device, inFlightFence, nullptr);
-
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
-
-        vkDestroyCommandPool(device, commandPool, nullptr);
+        frameRing.Destroy();
+        frameAllocator.Destroy();
+        vertexBuffer.Destroy();
+        // 暂存批次通过时间线提交，调度器销毁时执行剩余的延迟销毁，需要在管线注册表之前
+        stagingRing.Destroy();
+        scheduler.Destroy();
 
         for (auto framebuffer : swapChainFramebuffers) {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
 
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        pipelineLog.Save();
+        pipelineRegistry.Destroy();
         vkDestroyRenderPass(device, renderPass, nullptr);
 
         for (auto imageView : swapChainImageViews) {
@@ -202,6 +216,9 @@ public:
         }
 
         vkDestroySwapchainKHR(device, swapChain, nullptr);
+        ShaderBlobPool::Get().DestroyModules();
+        pipelineCache.Destroy();
+        allocator.Destroy();
         vkDestroyDevice(device, nullptr);
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
@@ -221,7 +238,7 @@ public:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -286,7 +303,25 @@ public:
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
 
-        return indices.IsComplete() && extensionsSupported && swapChainAdequate;
+        return indices.IsComplete() && extensionsSupported && swapChainAdequate && CheckTimelineSemaphoreSupport(device);
+    }
+
+    // 提交调度依赖Vulkan 1.2的时间线信号量
+    bool CheckTimelineSemaphoreSupport(VkPhysicalDevice device) const
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+        return vulkan12Features.timelineSemaphore == VK_TRUE;
     }
 
     QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device) const
@@ -421,8 +456,13 @@ public:
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
 
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.timelineSemaphore = VK_TRUE;
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &vulkan12Features;
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.pEnabledFeatures = &deviceFeatures;
@@ -442,6 +482,21 @@ public:
 
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+        // 上次运行保存的管线缓存，设备或驱动变化时自动丢弃
+        pipelineCache.Create(physicalDevice, device);
+        pipelineRegistry.Create(device, pipelineCache.GetHandle());
+        pipelineLog.Open();
+        pipelineRegistry.SetLog(&pipelineLog);
+
+        // 所有缓冲区和图像从VMA子分配
+        allocator.Create(instance, physicalDevice, device, VK_API_VERSION_1_2);
+        // 图形队列的提交都带时间线值，暂存批次和延迟销毁都按这个值回收
+        scheduler.Create(device);
+        VulkanTimeline& graphicsTimeline = scheduler.AddQueue(VulkanQueueType::Graphics, graphicsQueue);
+        // 图形队列总是支持传输，上传和绘制在同一个队列上，不需要所有权转移
+        stagingRing.Create(allocator, graphicsQueue, indices.graphicsFamily.value());
+        stagingRing.SetTimeline(&graphicsTimeline);
     }
 
     void CreateSwapChain() {
@@ -564,130 +619,115 @@ public:
         }
     }
 
+    // 加载着色器，热重载后从着色器库中取到的是新版本
+    SharedPtr<Shader> LoadShader(const String& name, const File::Path& path) {
+        auto shader = shaderLibrary.Get(name);
+        if (!shader) {
+            shader = shaderLibrary.Load(path);
+        }
+        return shader;
+    }
+
+    // 上次运行记录的管线在工作线程编译，CreateGraphicsPipeline请求时通常已经完成
+    void PrewarmPipelines() {
+        pipelineLog.Prewarm(pipelineRegistry, [this](const VulkanPipelineRecord& record, VulkanPipelineDesc& desc) {
+            // 只有一个渲染通道，附件不兼容的记录无法还原
+            if (record.Desc.RenderPass.ColorFormats != std::vector<VkFormat>{swapChainImageFormat} ||
+                record.Desc.RenderPass.DepthFormat != VK_FORMAT_UNDEFINED ||
+                record.Desc.RenderPass.Samples != VK_SAMPLE_COUNT_1_BIT) {
+                return false;
+            }
+            desc.RenderPass.Handle = renderPass;
+            desc.Program = record.Variant.IsEmpty()
+                ? LoadShader(record.ShaderName, record.ShaderPath)
+                : shaderLibrary.GetVariant(record.ShaderName, record.Variant);
+            return desc.Program != nullptr;
+        });
+    }
+
+    VulkanPipelineDesc MakePipelineDesc() {
+        auto shader = LoadShader("Triangle", CastToProjectPath("Asset/Shader/Triangle.glsl"));
+
+        // 相同的描述只创建一次管线，布局由着色器反射生成
+        VulkanPipelineDesc desc;
+        desc.Program = shader;
+        desc.VertexLayout.Bindings = {Vertex::getBindingDescription()};
+        const auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        desc.VertexLayout.Attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+        desc.Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        desc.Raster.CullMode = VK_CULL_MODE_BACK_BIT;
+        desc.Raster.FrontFace = VK_FRONT_FACE_CLOCKWISE;
+        desc.RenderPass.Handle = renderPass;
+        desc.RenderPass.ColorFormats = {swapChainImageFormat};
+
+        return desc;
+    }
+
     void CreateGraphicsPipeline() {
-        // 加载着色器
-        auto vertShaderCode = ReadFile(CastToProjectPath("Asset/Shader/vert.spv"));
-        auto fragShaderCode = ReadFile(CastToProjectPath("Asset/Shader/frag.spv"));
-
-        VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
-
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float) swapChainExtent.width;
-        viewport.height = (float) swapChainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset = {0, 0};
-        scissor.extent = swapChainExtent;
-
-        VkPipelineViewportStateCreateInfo viewportState = {};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
-        viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer = {};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-
-        VkPipelineMultisampleStateCreateInfo multisampling = {};
-        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
-
-        VkPipelineColorBlendStateCreateInfo colorBlending = {};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("无法创建管道布局！");
-        }
-
-        VkGraphicsPipelineCreateInfo pipelineInfo = {};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        graphicsPipeline = pipelineRegistry.GetOrCreate(MakePipelineDesc());
+        if (!graphicsPipeline) {
             throw std::runtime_error("无法创建图形管道！");
         }
+    }
+
+    // 热重载的管线编译结束后替换旧管线，编译失败时保留旧管线，命令缓冲区每帧重新记录
+    void SwapGraphicsPipeline() {
+        const VulkanPipeline* newPipeline = pendingPipeline;
+        pendingPipeline = nullptr;
+        if (newPipeline == graphicsPipeline) {
+            return;
+        }
+        if (!newPipeline->IsReady()) {
+            // 失败的管线从未提交给GPU，直接移除，不让注册表一直持有它和它的着色器
+            pipelineRegistry.Remove(newPipeline->GetDesc());
+            return;
+        }
 
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        // 旧管线可能还在飞行帧中使用，等这些帧执行完后再销毁，不阻塞当前帧
+        scheduler.Defer([this, desc = graphicsPipeline->GetDesc()] {
+            pipelineRegistry.Remove(desc);
+        });
+        graphicsPipeline = newPipeline;
     }
 
-    VkShaderModule CreateShaderModule(const std::vector<char>& code) const
-    {
-        VkShaderModuleCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    // 被取代的管线编译结束后移除，它们从未提交给GPU，不需要延迟销毁
+    void ReleaseSupersededPipelines() {
+        std::erase_if(supersededPipelines, [this](const VulkanPipeline* pipeline) {
+            // 之后又被请求到的管线仍在使用，只从列表中去掉
+            if (pipeline == pendingPipeline || pipeline == graphicsPipeline) {
+                return true;
+            }
+            if (pipeline->GetStatus() == VulkanPipelineStatus::Pending) {
+                return false;
+            }
+            pipelineRegistry.Remove(pipeline->GetDesc());
+            return true;
+        });
+    }
+
+    // 窗口大小改变后只重建交换链相关的图像和帧缓冲，视口是动态状态，管线不需要重建
+    void RecreateSwapChain() {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        while (width == 0 || height == 0) {
+            glfwGetFramebufferSize(window, &width, &height);
+            glfwWaitEvents();
+        }
+
+        vkDeviceWaitIdle(device);
 
-        VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("无法创建着色器模块！");
+        for (auto framebuffer : swapChainFramebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+        for (auto imageView : swapChainImageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
         }
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
 
-        return shaderModule;
+        CreateSwapChain();
+        CreateImageViews();
+        CreateFramebuffers();
+        frameRing.SetImageCount(static_cast<uint32_t>(swapChainImages.size()));
     }
 
     void CreateFramebuffers() {
@@ -713,159 +753,77 @@ public:
         }
     }
 
-    void CreateCommandPool() {
-        QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(physicalDevice);
-
-        VkCommandPoolCreateInfo poolInfo = {};
-        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-
-        if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-            throw std::runtime_error("无法创建命令池！");
-        }
-    }
-
     void CreateVertexBuffer() {
-        VkBufferCreateInfo bufferInfo = {};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = sizeof(vertices[0]) * vertices.size();
-        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &vertexBuffer) != VK_SUCCESS) {
-            throw std::runtime_error("无法创建顶点缓冲区！");
-        }
-
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, vertexBuffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &vertexBufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("无法分配顶点缓冲内存！");
-        }
-
-        vkBindBufferMemory(device, vertexBuffer, vertexBufferMemory, 0);
-
-        void* data;
-        vkMapMemory(device, vertexBufferMemory, 0, bufferInfo.size, 0, &data);
-        memcpy(data, vertices.data(), (size_t) bufferInfo.size);
-        vkUnmapMemory(device, vertexBufferMemory);
+        // 顶点数据放在设备本地内存中，通过暂存环形缓冲区上传
+        const VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
+        vertexBuffer = VulkanBuffer(allocator, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VulkanMemoryUsage::GpuOnly);
+        stagingRing.UploadBuffer(vertexBuffer, vertices.data(), size);
+        stagingRing.Submit();
     }
 
-    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+    void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
-
-        throw std::runtime_error("无法找到合适的内存类型！");
-    }
-
-    void CreateCommandBuffers() {
-        commandBuffers.resize(swapChainFramebuffers.size());
-
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
-
-        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("无法分配命令缓冲区！");
-        }
-
-        for (size_t i = 0; i < commandBuffers.size(); i++) {
-            VkCommandBufferBeginInfo beginInfo = {};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = 0;
-            beginInfo.pInheritanceInfo = nullptr;
-
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-                throw std::runtime_error("无法开始记录命令缓冲区！");
-            }
-
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapChainFramebuffers[i];
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapChainExtent;
-
-            VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
-
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-            VkBuffer vertexBuffers[] = {vertexBuffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-
-            vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(vertices.size()), 1, 0, 0);
-            vkCmdEndRenderPass(commandBuffers[i]);
-
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("无法记录命令缓冲区！");
-            }
-        }
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = swapChainExtent;
+
+        VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearColor;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline->GetHandle());
+        pipelineRegistry.SetDynamicState(commandBuffer, graphicsPipeline->GetDesc(), swapChainExtent);
+
+        VkBuffer vertexBuffers[] = {vertexBuffer.GetHandle()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+        vkCmdEndRenderPass(commandBuffer);
     }
 
+    // 每个飞行帧有自己的信号量、栅栏和命令池，CPU录制下一帧时GPU可以继续执行上一帧
     void CreateSyncObjects() {
-        VkSemaphoreCreateInfo semaphoreInfo = {};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VkFenceCreateInfo fenceInfo = {};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(physicalDevice);
 
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS) {
-            throw std::runtime_error("无法创建同步对象！");
-        }
+        frameRing.Create(device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
+        frameRing.SetImageCount(static_cast<uint32_t>(swapChainImages.size()));
+        frameAllocator.Create(allocator, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+        frameRing.SetFrameAllocator(&frameAllocator);
+        frameRing.SetScheduler(&scheduler);
     }
 
-    void DrawFrame() const
+    void DrawFrame()
     {
-        vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-        vkResetFences(device, 1, &inFlightFence);
+        // 只等待这一帧上一次的提交，其余的帧仍在GPU上执行
+        VulkanFrame& frame = frameRing.BeginFrame();
 
         uint32_t imageIndex;
-        vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frame.ImageAvailable, VK_NULL_HANDLE, &imageIndex);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            RecreateSwapChain();
+            return;
+        }
+        frameRing.BindImage(imageIndex);
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphore};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+        RecordCommandBuffer(frame.CommandBuffer, imageIndex);
 
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        // 本帧积累的上传在绘制命令之前提交，同一队列上的屏障保证绘制能看到结果
+        stagingRing.Submit();
+        stagingRing.Reclaim();
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
+        if (frameRing.Submit(graphicsQueue) != VK_SUCCESS) {
             throw std::runtime_error("无法提交绘制命令！");
         }
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &frame.RenderFinished;
 
         VkSwapchainKHR swapChains[] = {swapChain};
         presentInfo.swapchainCount = 1;
@@ -873,7 +831,12 @@ public:
         presentInfo.pImageIndices = &imageIndex;
         presentInfo.pResults = nullptr;
 
-        vkQueuePresentKHR(presentQueue, &presentInfo);
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        frameRing.EndFrame();
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+            framebufferResized = false;
+            RecreateSwapChain();
+        }
     }
 
     bool checkValidationLayerSupport() const
@@ -905,6 +868,11 @@ public:
 
 int main() {
     try {
+        // ShaderBaker生成的归档，不带编译器的构建只能从这里加载；在着色器库和任何编译开始前挂载一次
+        if (std::filesystem::exists(ShaderCache::GetArchivePath())) {
+            ShaderCache::MountArchive(ShaderCache::GetArchivePath());
+        }
+
         TriangleApp app;
         app.InitWindow();              // 初始化GLFW窗口，设置窗口大小和标题
 
@@ -915,12 +883,11 @@ int main() {
         app.CreateSwapChain();         // 创建交换链，管理用于渲染的图像缓冲区
         app.CreateImageViews();        // 为交换链中的每个图像创建图像视图
         app.createRenderPass();        // 设置渲染通道，定义渲染操作和图像布局转换
+        app.PrewarmPipelines();        // 在后台编译上次运行记录的所有管线
         app.CreateGraphicsPipeline();  // 创建图形管线，包括着色器、顶点输入等配置
         app.CreateFramebuffers();      // 为每个交换链图像创建帧缓冲
-        app.CreateCommandPool();       // 创建命令池，用于分配命令缓冲区
         app.CreateVertexBuffer();      // 创建顶点缓冲区，存储三角形的顶点数据
-        app.CreateCommandBuffers();    // 创建命令缓冲区，记录渲染命令
-        app.CreateSyncObjects();       // 创建同步对象，协调GPU和CPU的操作
+        app.CreateSyncObjects();       // 创建每个飞行帧的同步对象和命令池，协调GPU和CPU的操作
 
         app.MainLoop();                // 进入主渲染循环，处理窗口事件并绘制帧
 
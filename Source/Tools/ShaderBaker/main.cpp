@@ -0,0 +1,140 @@
+﻿#include <cstdio>
+#include <cstdlib>
+
+#include "Core/BaseType.h"
+#include "Shader/ShaderArchive.h"
+#include "Shader/ShaderCompiler.h"
+#include "Shader/ShaderReflection.h"
+
+/**
+ * Shader离线预编译工具
+ *
+ * 遍历资源目录，使用与运行时相同的ShaderCompiler::CompileAll并行编译所有shader和变体，
+ * 结果连同反射数据写入归档，不带编译器(PL_SHADER_NO_COMPILER)的运行时只从该归档加载 \n
+ * 变体在shader旁边的 <文件名>.variants 中列出，每行一个变体，宏之间用空格分隔，如 SKINNING SHADOW_QUALITY=2 \n
+ * 包含目录中的文件只作为被包含文件，不单独编译 \n
+ * 编译配置默认为release，去除调试信息以减小归档体积
+ *
+ * 用法: ShaderBaker [资源目录] [归档路径] [debug|release|size]
+ */
+
+namespace
+{
+    bool IsShaderSource(const File::Path& path)
+    {
+        const String extension = path.extension().string();
+        return extension == ".glsl" || extension == ".hlsl";
+    }
+
+    bool IsUnder(const File::Path& path, const File::Path& directory)
+    {
+        const File::Path relative = path.lexically_relative(directory);
+        return !relative.empty() && *relative.begin() != "..";
+    }
+
+    // 读取变体列表，文件不存在时为空；以#开头的行为注释
+    Vector<ShaderVariantKey> ReadVariantList(const File::Path& shaderPath)
+    {
+        File::Path listPath = shaderPath;
+        listPath += ".variants";
+
+        Vector<ShaderVariantKey> variants;
+        std::ifstream in(listPath);
+        String line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line.front() == '#')
+                continue;
+
+            ShaderVariantKey variant;
+            std::istringstream tokens(line);
+            String token;
+            while (tokens >> token)
+            {
+                const size_t equal = token.find('=');
+                if (equal == String::npos)
+                    variant.Define(token);
+                else
+                    variant.Define(token.substr(0, equal), token.substr(equal + 1));
+            }
+            if (!variant.IsEmpty())
+                variants.push_back(std::move(variant));
+        }
+        return variants;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const File::Path sourceDir   = argc > 1 ? File::Path(argv[1]) : CastToProjectPath("Asset/Shader");
+    const File::Path archivePath = argc > 2 ? File::Path(argv[2]) : ShaderCache::GetArchivePath();
+    const File::Path includeDir  = CastToProjectPath(Utils::Shader::GetShaderIncludeDir()).lexically_normal();
+    const ShaderCompileProfile profile = argc > 3 ? Utils::Shader::ShaderCompileProfileFromString(argv[3]) : ShaderCompileProfile::Release;
+    if (profile == ShaderCompileProfile::Count)
+    {
+        std::printf("unknown compile profile '%s', expected debug, release or size\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+    ShaderCompiler::SetCompileProfile(profile);
+
+    const TimePoint start = Now();
+
+    // 收集编译请求，每个shader先编译默认变体
+    Vector<ShaderCompileRequest> requests;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(sourceDir, error))
+    {
+        const File::Path path = std::filesystem::absolute(entry.path()).lexically_normal();
+        if (!entry.is_regular_file() || !IsShaderSource(path) || IsUnder(path, includeDir))
+            continue;
+
+        requests.push_back({path, {}});
+        for (ShaderVariantKey& variant : ReadVariantList(path))
+        {
+            requests.push_back({path, std::move(variant)});
+        }
+    }
+    if (error)
+    {
+        std::printf("could not read shader directory '%s': %s\n", sourceDir.string().c_str(), error.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Baking %zu shader variants from '%s' (%s)\n", requests.size(), sourceDir.string().c_str(),
+        Utils::Shader::ShaderCompileProfileToString(profile));
+    const Vector<CacheCompileResult> results = ShaderCompiler::CompileAll(Span<const ShaderCompileRequest>(requests), ShaderAPIFlags::Vulkan);
+
+    // 预编译查找键指向各阶段二进制，反射数据以内容哈希为键，与运行时查找方式一致
+    Map<u64, SPIRVBinary> entries;
+    u32 failedCount {0};
+    for (size_t i {0}; i < results.size(); ++i)
+    {
+        const ShaderCompileRequest& request = requests[i];
+        const CacheCompileResult& result = results[i];
+        if (!result.Success)
+        {
+            std::printf("  FAILED %s [%s]\n", request.FilePath.string().c_str(), request.Variant.ToString().c_str());
+            ++failedCount;
+            continue;
+        }
+
+        const String assetName = ShaderCache::GetAssetName(request.FilePath);
+        for (const auto& [stage, binary] : result.Sources)
+        {
+            entries[ShaderCache::ComputeBakedKey(assetName, stage, request.Variant.GetHash())] = binary;
+        }
+        entries[ShaderReflection::ComputeKey(result.Sources)] = ShaderReflection::Serialize(ShaderReflection::ReflectAll(result.ShaderName, result.Sources));
+    }
+
+    if (!archivePath.parent_path().empty())
+        std::filesystem::create_directories(archivePath.parent_path(), error);
+    if (!ShaderArchive::Write(archivePath, entries))
+    {
+        std::printf("could not write archive '%s'\n", archivePath.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Wrote %zu entries to '%s' (%ju bytes) in %.2f s, %u failed\n", entries.size(), archivePath.string().c_str(),
+        static_cast<uintmax_t>(std::filesystem::file_size(archivePath, error)), Elapsed(start, Now()).count(), failedCount);
+    return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
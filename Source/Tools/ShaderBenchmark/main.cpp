@@ -0,0 +1,343 @@
+﻿#include <cstdio>
+#include <fstream>
+#include <ranges>
+
+#include "Core/BaseType.h"
+#include "Core/Compression.h"
+#include "Shader/ShaderCompiler.h"
+#include "Shader/ShaderReflection.h"
+
+/**
+ * Shader编译器基准测试
+ *
+ * 1. 对比每次编译都构造编译器和编译选项与复用线程局部编译上下文的单次编译耗时 \n
+ * 2. 在生成的不同规模语料上分别测量预处理、Vulkan冷/热缓存编译、OpenGL编译和反射各阶段的单文件耗时，
+ *    以及LZ4压缩率、解码吞吐和压缩/未压缩缓存条目的读取耗时 \n
+ * 3. 通过CompileAll冷缓存编译全部语料，统计每秒编译文件数，这是运行时实际使用的批量编译路径 \n
+ *    另外在不同线程数下逐文件调用CacheCompile作为对照，每个任务编译一个文件的所有阶段，不经过CompileAll的阶段级并行 \n
+ * 语料和缓存都生成在临时目录中，不影响项目缓存，不需要GPU
+ *
+ * 用法: ShaderBenchmark [迭代次数] [每档语料文件数]
+ */
+
+namespace
+{
+    constexpr Str TinyVertexShader = R"(#version 450
+layout(location = 0) out vec3 fragColor;
+vec2 positions[3] = vec2[](vec2(0.0, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5));
+void main()
+{
+    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    fragColor = vec3(1.0);
+}
+)";
+
+    struct BenchmarkStats
+    {
+        f64 Mean {0.0};     ///< 平均值(微秒)
+        f64 P50 {0.0};      ///< 中位数(微秒)
+        f64 P95 {0.0};      ///< 95分位(微秒)
+        f64 P99 {0.0};      ///< 99分位(微秒)
+    };
+
+    // 语料规模档位，函数数量决定单个文件的源码长度和编译耗时
+    struct CorpusTier
+    {
+        Str Name;
+        u32 FunctionCount;
+    };
+    constexpr CorpusTier CorpusTiers[] = {{"small", 2}, {"medium", 32}, {"large", 256}};
+
+    BenchmarkStats ComputeStats(Vector<f64> samples)
+    {
+        BenchmarkStats stats;
+        if (samples.empty())
+            return stats;
+
+        std::ranges::sort(samples);
+        stats.Mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<f64>(samples.size());
+        stats.P50  = samples[samples.size() / 2];
+        stats.P95  = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+        stats.P99  = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        return stats;
+    }
+
+    void PrintStats(const Str name, const BenchmarkStats& stats)
+    {
+        std::printf("%-28s mean %10.1f us   p50 %10.1f us   p95 %10.1f us   p99 %10.1f us\n", name, stats.Mean, stats.P50, stats.P95, stats.P99);
+    }
+
+    template<typename F>
+    BenchmarkStats Measure(const u32 iterations, F&& func)
+    {
+        Vector<f64> samples;
+        samples.reserve(iterations);
+        for (u32 i {0}; i < iterations; ++i)
+        {
+            const TimePoint start = Now();
+            func(i);
+            samples.push_back(Elapsed(start, Now()).count() * 1e6);
+        }
+        return ComputeStats(std::move(samples));
+    }
+
+    bool Compile(ShaderCompileContext& context)
+    {
+        const shaderc::CompileOptions& options = context.GetVulkanTarget(ShaderCompiler::GetCompileProfile()).Options;
+        const shaderc::SpvCompilationResult module = context.Compiler.CompileGlslToSpv(
+            TinyVertexShader, std::strlen(TinyVertexShader), shaderc_vertex_shader, "benchmark.glsl", options);
+        return module.GetCompilationStatus() == shaderc_compilation_status_success;
+    }
+
+    // 生成一个顶点+片段shader，seed让每个文件的源码不同，避免彼此命中缓存
+    String GenerateShaderSource(const u32 functionCount, const u32 seed)
+    {
+        String functions;
+        String calls;
+        for (u32 i {0}; i < functionCount; ++i)
+        {
+            const String index = std::to_string(i);
+            functions += "float Func" + index + "(float x)\n{\n"
+                "    float v = sin(x * " + index + ".0 + Seed) + cos(x - " + index + ".0);\n"
+                "    for (int i = 0; i < 4; ++i) { v = v * 0.5 + fract(v * float(i + " + index + ")); }\n"
+                "    return v;\n}\n";
+            calls += "    v += Func" + index + "(v + " + index + ".0);\n";
+        }
+        const String seedLine = "const float Seed = " + std::to_string(seed) + ".0;\n";
+
+        return "#pragma type vertex\n#version 450\n" + seedLine +
+            "layout(location = 0) in vec3 inPosition;\n"
+            "layout(location = 1) in vec3 inColor;\n"
+            "layout(location = 0) out vec3 fragColor;\n"
+            "layout(set = 0, binding = 0) uniform Camera { mat4 ViewProjection; vec4 Params; } camera;\n"
+            + functions +
+            "void main()\n{\n    float v = inPosition.x + camera.Params.x;\n" + calls +
+            "    gl_Position = camera.ViewProjection * vec4(inPosition, 1.0);\n"
+            "    fragColor = inColor * v;\n}\n"
+            "#pragma type fragment\n#version 450\n" + seedLine +
+            "layout(location = 0) in vec3 fragColor;\n"
+            "layout(location = 0) out vec4 outColor;\n"
+            "layout(set = 0, binding = 1) uniform sampler2D albedo;\n"
+            + functions +
+            "void main()\n{\n    float v = fragColor.x;\n" + calls +
+            "    outColor = texture(albedo, fragColor.xy) * v;\n}\n";
+    }
+
+    Vector<File::Path> GenerateCorpus(const File::Path& directory, const CorpusTier& tier, const u32 fileCount, u32& seed)
+    {
+        Vector<File::Path> files;
+        files.reserve(fileCount);
+        for (u32 i {0}; i < fileCount; ++i)
+        {
+            File::Path path = directory / (String(tier.Name) + "_" + std::to_string(i) + ".glsl");
+            std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc) << GenerateShaderSource(tier.FunctionCount, seed++);
+            files.push_back(std::move(path));
+        }
+        return files;
+    }
+
+    // 清空临时目录下的编译缓存，下一次编译为冷缓存
+    void ClearCache()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(ShaderCache::GetCacheDir(), error);
+    }
+
+    // 对比压缩与未压缩缓存条目的读取耗时，文件已在系统页缓存中，结果只反映解码和复制的开销
+    void RunCacheDecode(const Vector<SPIRVBinaryDatas>& binaries)
+    {
+        Vector<const SPIRVBinary*> blobs;
+        for (const SPIRVBinaryDatas& stages : binaries)
+        {
+            for (const SPIRVBinary& binary : stages | std::views::values)
+            {
+                blobs.push_back(&binary);
+            }
+        }
+        if (blobs.empty())
+            return;
+
+        size_t rawBytes {0};
+        size_t compressedBytes {0};
+        f64 decodeSeconds {0.0};
+        for (const SPIRVBinary* binary : blobs)
+        {
+            const Span<const u8> raw {reinterpret_cast<const u8*>(binary->data()), binary->size() * sizeof(u32)};
+            Vector<u8> compressed;
+            Compression::CompressLZ4(raw, compressed);
+
+            SPIRVBinary decoded(binary->size());
+            const TimePoint start = Now();
+            Compression::DecompressLZ4(compressed, {reinterpret_cast<u8*>(decoded.data()), raw.size()});
+            decodeSeconds += Elapsed(start, Now()).count();
+
+            rawBytes += raw.size();
+            compressedBytes += compressed.size();
+        }
+        std::printf("%-28s ratio %6.2f          decode %10.1f MB/s\n", "lz4 codec",
+            static_cast<f64>(rawBytes) / static_cast<f64>(compressedBytes), static_cast<f64>(rawBytes) / decodeSeconds / 1e6);
+
+        const bool compressionEnabled = ShaderCache::IsCompressionEnabled();
+        for (const bool compress : {false, true})
+        {
+            ShaderCache::SetCompressionEnabled(compress);
+            Vector<File::Path> paths;
+            for (size_t i {0}; i < blobs.size(); ++i)
+            {
+                paths.push_back(ShaderCache::GetEntryPath("decode", i, compress ? ".lz4" : ".raw"));
+                ShaderCache::Store(paths.back(), i, *blobs[i]);
+            }
+            PrintStats(compress ? "cache read (lz4)" : "cache read (raw)", Measure(static_cast<u32>(paths.size()), [&](const u32 i)
+            {
+                ShaderCacheHeader header;
+                SPIRVBinary binary;
+                ShaderCache::ReadEntry(paths[i], header, binary);
+            }));
+        }
+        ShaderCache::SetCompressionEnabled(compressionEnabled);
+    }
+
+    void RunCorpusPhases(const CorpusTier& tier, const Vector<File::Path>& files)
+    {
+        const u32 fileCount = static_cast<u32>(files.size());
+        Vector<ShaderPreprocessResult> processResults(fileCount);
+        Vector<SPIRVBinaryDatas> binaries(fileCount);
+
+        std::printf("\nCorpus '%s' (%u functions per stage), %u files\n", tier.Name, tier.FunctionCount, fileCount);
+
+        PrintStats("preprocess", Measure(fileCount, [&](const u32 i)
+        {
+            processResults[i] = ShaderCompiler::PreprocessShaderFile(files[i]);
+        }));
+
+        ClearCache();
+        PrintStats("vulkan compile (cold)", Measure(fileCount, [&](const u32 i)
+        {
+            binaries[i] = ShaderCompiler::CompileVulkanBinaries(processResults[i]);
+        }));
+
+        PrintStats("vulkan compile (warm)", Measure(fileCount, [&](const u32 i)
+        {
+            binaries[i] = ShaderCompiler::CompileVulkanBinaries(processResults[i]);
+        }));
+
+        // Vulkan缓存保留，只测量交叉编译和OpenGL编译本身
+        PrintStats("opengl compile (cold)", Measure(fileCount, [&](const u32 i)
+        {
+            ShaderCompiler::CompileOpenGLBinaries(processResults[i]);
+        }));
+
+        PrintStats("reflection", Measure(fileCount, [&](const u32 i)
+        {
+            ShaderReflectionData data;
+            String error;
+            for (const auto& [stage, binary] : binaries[i])
+            {
+                ShaderReflection::Merge(data, ShaderReflection::Reflect(stage, binary), error);
+            }
+        }));
+
+        RunCacheDecode(binaries);
+    }
+
+    void RunThroughput(const Vector<File::Path>& files)
+    {
+        std::printf("\nCold compile throughput, %zu files\n", files.size());
+
+        // 批量编译路径：预处理和各阶段编译都分散到编译器的共享线程池
+        {
+            ClearCache();
+            const TimePoint start = Now();
+            const Vector<CacheCompileResult> results = ShaderCompiler::CompileAll(Span<const File::Path>(files), ShaderAPIFlags::Vulkan);
+            const f64 seconds = Elapsed(start, Now()).count();
+            const auto failedCount = std::ranges::count_if(results, [](const CacheCompileResult& result) { return !result.Success; });
+            std::printf("CompileAll    %10.1f ms   %10.1f files/s   %td failed\n",
+                seconds * 1e3, static_cast<f64>(files.size()) / seconds, failedCount);
+        }
+
+        // 对照：逐文件调用CacheCompile，只反映单个文件串行编译各阶段时随线程数的扩展，不代表CompileAll的吞吐
+        const u32 maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::printf("Raw per-file CacheCompile, no stage-level parallelism\n");
+
+        for (u32 threadCount {1};; threadCount = std::min(threadCount * 2, maxThreads))
+        {
+            ClearCache();
+            u32 failedCount {0};
+            const TimePoint start = Now();
+            {
+                ThreadPool threadPool(threadCount);
+                Vector<std::future<CacheCompileResult>> tasks;
+                tasks.reserve(files.size());
+                for (const File::Path& path : files)
+                {
+                    tasks.push_back(threadPool.Submit([&path] { return ShaderCompiler::CacheCompile(path, ShaderAPIFlags::Vulkan); }));
+                }
+                for (auto& task : tasks)
+                {
+                    failedCount += task.get().Success ? 0 : 1;
+                }
+            }
+            const f64 seconds = Elapsed(start, Now()).count();
+            std::printf("%3u threads   %10.1f ms   %10.1f files/s   %u failed\n",
+                threadCount, seconds * 1e3, static_cast<f64>(files.size()) / seconds, failedCount);
+
+            if (threadCount == maxThreads)
+                break;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const u32 iterations = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : 200;
+    const u32 fileCount  = argc > 2 ? static_cast<u32>(std::strtoul(argv[2], nullptr, 10)) : 16;
+
+    // 缓存和依赖图放到临时目录，与项目缓存隔离；必须在第一次编译前设置，之后依赖图已经加载
+    const File::Path workDir = std::filesystem::temp_directory_path() / "PulseShaderBenchmark";
+    const File::Path corpusDir = workDir / "Corpus";
+    ShaderCache::SetRootDir(workDir / "Cache");
+
+    // 预热，排除首次初始化glslang的开销
+    if (!Compile(ShaderCompiler::GetCompileContext()))
+    {
+        std::printf("benchmark shader failed to compile\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Profile %s, per-file compile overhead, %u iterations\n",
+        Utils::Shader::ShaderCompileProfileToString(ShaderCompiler::GetCompileProfile()), iterations);
+
+    PrintStats("fresh compiler per call", Measure(iterations, [](u32)
+    {
+        ShaderCompileContext context;
+        Compile(context);
+    }));
+
+    PrintStats("reused compile context", Measure(iterations, [](u32)
+    {
+        Compile(ShaderCompiler::GetCompileContext());
+    }));
+
+    std::error_code error;
+    std::filesystem::remove_all(workDir, error);
+    std::filesystem::create_directories(corpusDir, error);
+    if (error)
+    {
+        std::printf("could not create work directory '%s': %s\n", workDir.string().c_str(), error.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    u32 seed {0};
+    Vector<File::Path> allFiles;
+    for (const CorpusTier& tier : CorpusTiers)
+    {
+        const Vector<File::Path> files = GenerateCorpus(corpusDir, tier, fileCount, seed);
+        RunCorpusPhases(tier, files);
+        allFiles.insert(allFiles.end(), files.begin(), files.end());
+    }
+
+    RunThroughput(allFiles);
+
+    std::filesystem::remove_all(workDir, error);
+    return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <span>
 #include <stack>
 #include <string>
 #include <vector>
@@ -78,6 +79,10 @@ constexpr Pair<K, V> MakePair(K&& key, V&& value){
 template<typename T>
 using Optional = std::optional<T>;
 
+// Span视图包装
+template<typename T>
+using Span = std::span<T>;
+
 /** ---------------------------智能指针-------------------------*/
 
 template<typename T >
@@ -143,6 +148,11 @@ void HashCombine(size_t& seed, const T& v){
     std::hash<T> hasher;
     seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);}
 
+// 向上对齐到alignment的整数倍，alignment不要求是2的幂
+template<typename T>
+constexpr T AlignUp(const T value, const T alignment){
+    return alignment == 0 ? value : (value + alignment - 1) / alignment * alignment;}
+
 
 #define PL_ENGINE_NAME "Pulse Engine"
 
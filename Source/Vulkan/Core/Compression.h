@@ -0,0 +1,180 @@
+﻿#pragma once
+
+#include <cstring>
+
+#include "BaseType.h"
+
+/**
+ * @brief 快速无损压缩
+ * @details
+ * 输出LZ4块格式，可以被任何标准LZ4解码器解码 \n
+ * 压缩使用单探测哈希表的贪心匹配，速度优先于压缩率；解码对输入做完整的边界检查，损坏的数据只会返回失败 \n
+ * 块格式本身不记录原始大小，调用方需要自行保存
+ */
+namespace Compression
+{
+    namespace Detail
+    {
+        constexpr size_t MinMatch     = 4;      ///< 最短匹配长度
+        constexpr size_t LastLiterals = 5;      ///< 块末尾必须保留为字面量的字节数
+        constexpr size_t MatchLimit   = 12;     ///< 最后一个匹配距块末尾的最小距离
+        constexpr size_t MaxOffset    = 65535;  ///< 最大回溯距离
+        constexpr u32 HashLog         = 12;
+
+        inline u32 Read32(const u8* p) { u32 v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+        inline u32 HashSequence(const u32 sequence) { return (sequence * 2654435761u) >> (32 - HashLog); }
+
+        // 写入长度的扩展字节，nibble已经写满15时调用
+        inline void WriteLength(Vector<u8>& out, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+            {
+                out.push_back(255);
+            }
+            out.push_back(static_cast<u8>(length));
+        }
+
+        // 读取长度的扩展字节，越界时返回false
+        inline bool ReadLength(const Span<const u8> src, size_t& pos, size_t& length)
+        {
+            u8 byte;
+            do
+            {
+                if (pos >= src.size())
+                    return false;
+                byte = src[pos++];
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+        inline void WriteSequence(Vector<u8>& out, const u8* literals, const size_t literalLength, const size_t offset, const size_t matchLength)
+        {
+            const size_t matchCode = matchLength - MinMatch;
+            out.push_back(static_cast<u8>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+            if (literalLength >= 15)
+                WriteLength(out, literalLength - 15);
+            out.insert(out.end(), literals, literals + literalLength);
+
+            out.push_back(static_cast<u8>(offset & 0xFF));
+            out.push_back(static_cast<u8>(offset >> 8));
+            if (matchCode >= 15)
+                WriteLength(out, matchCode - 15);
+        }
+    }
+
+    /** 压缩结果的最大字节数 */
+    inline size_t GetMaxCompressedSize(const size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    /** 压缩一段数据，结果追加到out */
+    inline void CompressLZ4(const Span<const u8> src, Vector<u8>& out)
+    {
+        using namespace Detail;
+
+        out.reserve(out.size() + GetMaxCompressedSize(src.size()));
+        const u8* data = src.data();
+        const size_t size = src.size();
+        size_t anchor {0};
+
+        if (size > MatchLimit)
+        {
+            // 表中存放位置+1，0表示空
+            Array<u32, 1u << HashLog> table {};
+            const size_t matchStartLimit = size - MatchLimit;
+            const size_t matchEndLimit   = size - LastLiterals;
+
+            for (size_t pos {0}; pos <= matchStartLimit;)
+            {
+                const u32 sequence = Read32(data + pos);
+                u32& slot = table[HashSequence(sequence)];
+                const size_t candidate = slot;
+                slot = static_cast<u32>(pos + 1);
+
+                if (candidate == 0 || pos - (candidate - 1) > MaxOffset || Read32(data + candidate - 1) != sequence)
+                {
+                    ++pos;
+                    continue;
+                }
+
+                const size_t reference = candidate - 1;
+                size_t matchLength = MinMatch;
+                while (pos + matchLength < matchEndLimit && data[reference + matchLength] == data[pos + matchLength])
+                {
+                    ++matchLength;
+                }
+
+                WriteSequence(out, data + anchor, pos - anchor, pos - reference, matchLength);
+                pos += matchLength;
+                anchor = pos;
+            }
+        }
+
+        // 最后一个序列只有字面量
+        const size_t literalLength = size - anchor;
+        out.push_back(static_cast<u8>(std::min<size_t>(literalLength, 15) << 4));
+        if (literalLength >= 15)
+            WriteLength(out, literalLength - 15);
+        out.insert(out.end(), data + anchor, data + size);
+    }
+
+    /** 解压一段数据，dst的大小必须等于原始大小，数据损坏或大小不符时返回false */
+    inline bool DecompressLZ4(const Span<const u8> src, const Span<u8> dst)
+    {
+        using namespace Detail;
+
+        size_t srcPos {0};
+        size_t dstPos {0};
+        while (srcPos < src.size())
+        {
+            const u8 token = src[srcPos++];
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(src, srcPos, literalLength))
+                return false;
+            if (literalLength > src.size() - srcPos || literalLength > dst.size() - dstPos)
+                return false;
+            std::memcpy(dst.data() + dstPos, src.data() + srcPos, literalLength);
+            srcPos += literalLength;
+            dstPos += literalLength;
+
+            // 最后一个序列没有匹配部分
+            if (srcPos == src.size())
+                break;
+
+            if (src.size() - srcPos < 2)
+                return false;
+            const size_t offset = src[srcPos] | (static_cast<size_t>(src[srcPos + 1]) << 8);
+            srcPos += 2;
+            if (offset == 0 || offset > dstPos)
+                return false;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(src, srcPos, matchLength))
+                return false;
+            matchLength += MinMatch;
+            if (matchLength > dst.size() - dstPos)
+                return false;
+
+            // 回溯距离小于匹配长度时源和目标重叠，只能逐字节复制
+            u8* out = dst.data() + dstPos;
+            const u8* match = out - offset;
+            if (offset >= matchLength)
+            {
+                std::memcpy(out, match, matchLength);
+            }
+            else
+            {
+                for (size_t i {0}; i < matchLength; ++i)
+                {
+                    out[i] = match[i];
+                }
+            }
+            dstPos += matchLength;
+        }
+        return dstPos == dst.size();
+    }
+}
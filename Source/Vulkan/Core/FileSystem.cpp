@@ -0,0 +1,166 @@
+﻿#include "FileSystem.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifdef PL_PLAT_WINDOWS
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace File
+{
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            m_Data   = std::exchange(other.m_Data, nullptr);
+            m_Size   = std::exchange(other.m_Size, 0);
+            m_IsOpen = std::exchange(other.m_IsOpen, false);
+            m_Buffer = std::move(other.m_Buffer);
+#ifdef PL_PLAT_WINDOWS
+            m_FileHandle    = std::exchange(other.m_FileHandle, nullptr);
+            m_MappingHandle = std::exchange(other.m_MappingHandle, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    bool MappedFile::Open(const Path& path)
+    {
+        Close();
+#ifdef PL_PLAT_WINDOWS
+        HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        m_FileHandle = file;
+        m_Size       = static_cast<size_t>(fileSize.QuadPart);
+        m_IsOpen     = true;
+        // 空文件不能被映射
+        if (m_Size == 0)
+            return true;
+
+        m_MappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_MappingHandle != nullptr)
+        {
+            m_Data = static_cast<const u8*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+            if (m_Data != nullptr)
+                return true;
+            CloseHandle(m_MappingHandle);
+            m_MappingHandle = nullptr;
+        }
+
+        // 无法映射时退回到一次性读入
+        m_Buffer.resize(m_Size);
+        for (size_t offset {0}; offset < m_Size;)
+        {
+            const DWORD chunk = static_cast<DWORD>(std::min<size_t>(m_Size - offset, 1u << 30));
+            DWORD bytesRead {0};
+            if (!::ReadFile(file, m_Buffer.data() + offset, chunk, &bytesRead, nullptr) || bytesRead == 0)
+            {
+                Close();
+                return false;
+            }
+            offset += bytesRead;
+        }
+        m_Data = m_Buffer.data();
+        return true;
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat fileStat {};
+        if (::fstat(fd, &fileStat) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        m_Size   = static_cast<size_t>(fileStat.st_size);
+        m_IsOpen = true;
+        // 空文件不能被映射
+        if (m_Size == 0)
+        {
+            ::close(fd);
+            return true;
+        }
+
+        void* data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            // 映射建立后文件描述符即可关闭
+            ::close(fd);
+            m_Data = static_cast<const u8*>(data);
+            return true;
+        }
+
+        // 无法映射时退回到一次性读入
+        m_Buffer.resize(m_Size);
+        for (size_t offset {0}; offset < m_Size;)
+        {
+            const ssize_t bytesRead = ::pread(fd, m_Buffer.data() + offset, m_Size - offset, static_cast<off_t>(offset));
+            if (bytesRead <= 0)
+            {
+                ::close(fd);
+                Close();
+                return false;
+            }
+            offset += static_cast<size_t>(bytesRead);
+        }
+        ::close(fd);
+        m_Data = m_Buffer.data();
+        return true;
+#endif
+    }
+
+    void MappedFile::Close()
+    {
+#ifdef PL_PLAT_WINDOWS
+        if (m_Data != nullptr && m_Buffer.empty())
+            UnmapViewOfFile(m_Data);
+        if (m_MappingHandle != nullptr)
+            CloseHandle(m_MappingHandle);
+        if (m_FileHandle != nullptr)
+            CloseHandle(m_FileHandle);
+        m_MappingHandle = nullptr;
+        m_FileHandle    = nullptr;
+#else
+        if (m_Data != nullptr && m_Buffer.empty())
+            ::munmap(const_cast<u8*>(m_Data), m_Size);
+#endif
+        m_Buffer.clear();
+        m_Buffer.shrink_to_fit();
+        m_Data   = nullptr;
+        m_Size   = 0;
+        m_IsOpen = false;
+    }
+
+    bool ReadTextFile(const Path& path, String& outText)
+    {
+        // 标准流在Windows上以共享写入的方式打开，读到文件末尾为止，文件在读取期间变短也不会越界
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (!in.is_open())
+            return false;
+        outText.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !in.bad();
+    }
+}
@@ -1,9 +1,63 @@
 ﻿#pragma once
 
 #include <filesystem>
+
+#include "BaseType.h"
+
 namespace File
 {
     using Path = std::filesystem::path;
+
+    /**
+     * @class MappedFile
+     * @brief 只读内存映射文件
+     * @details
+     * 打开后整个文件被映射到进程地址空间，数据按需由系统换入，不产生额外的堆拷贝 \n
+     * 映射基址按页对齐，映射在对象销毁或Close时解除 \n
+     * 文件系统或文件类型不支持映射时退回到一次性读入内存，接口行为不变 \n
+     * 映射期间文件被其他进程截断时访问会触发SIGBUS，Windows上映射期间其他进程也无法写入，只用于不会被编辑的文件
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const Path& path) { Open(path); }
+        ~MappedFile() { Close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        /** 映射文件，失败时返回false */
+        bool Open(const Path& path);
+
+        /** 解除映射 */
+        void Close();
+
+        bool IsOpen() const { return m_IsOpen; }
+        bool IsMapped() const { return m_IsOpen && m_Buffer.empty(); }
+        const u8* GetData() const { return m_Data; }
+        size_t GetSize() const { return m_Size; }
+        Span<const u8> GetSpan() const { return {m_Data, m_Size}; }
+        StringView GetText() const { return {reinterpret_cast<const char*>(m_Data), m_Size}; }
+
+    private:
+        const u8* m_Data {nullptr};     ///< 映射数据
+        size_t m_Size {0};              ///< 文件大小
+        bool m_IsOpen {false};          ///< 是否已打开
+        Vector<u8> m_Buffer;            ///< 无法映射时读入的数据
+#ifdef PL_PLAT_WINDOWS
+        void* m_FileHandle {nullptr};   ///< 文件句柄
+        void* m_MappingHandle {nullptr};///< 映射句柄
+#endif
+    };
+
+    /**
+     * @brief 把整个文件读入outText
+     * @details 用于shader源码等会被编辑器修改的文件，不持有映射，读取期间文件被改写只会读到旧的或不完整的内容，不会阻止写入
+     */
+    bool ReadTextFile(const Path& path, String& outText);
 }
 
 
@@ -19,3 +73,8 @@ inline static File::Path CastToProjectPath(const File::Path& path)
 {
     return GetProjectDir() / path;
 }
+// 项目缓存根目录，不随工作目录变化
+inline static File::Path GetProjectCacheDir()
+{
+    return CastToProjectPath(".cache");
+}
@@ -0,0 +1,165 @@
+﻿#include "FileWatcher.h"
+
+#ifdef PL_PLAT_LINUX
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+#include "Core/Log/Log.h"
+
+namespace File
+{
+    FileWatcher::FileWatcher(const Path& directory, Callback callback)
+        : m_Directory(directory.lexically_normal())
+        , m_Callback(std::move(callback))
+    {
+#ifdef PL_PLAT_LINUX
+        m_NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_NotifyFd < 0)
+        {
+            Log::CatError("File", "Could not initialize inotify for '{0}'", m_Directory.string());
+            return;
+        }
+        AddWatch(m_Directory);
+#else
+        // 记录初始状态，启动前已存在的文件不触发回调
+        Scan(false);
+#endif
+        m_Thread = std::thread([this] { Run(); });
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        m_Stop = true;
+#ifndef PL_PLAT_LINUX
+        {
+            std::lock_guard lock(m_StopMutex);
+        }
+        m_StopCondition.notify_all();
+#endif
+        if (m_Thread.joinable())
+            m_Thread.join();
+#ifdef PL_PLAT_LINUX
+        if (m_NotifyFd >= 0)
+            close(m_NotifyFd);
+#endif
+    }
+
+#ifdef PL_PLAT_LINUX
+    void FileWatcher::AddWatch(const Path& directory)
+    {
+        constexpr u32 mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+        if (const i32 wd = inotify_add_watch(m_NotifyFd, directory.c_str(), mask); wd >= 0)
+            m_WatchDirs[wd] = directory;
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+        {
+            if (entry.is_directory(error))
+                AddWatch(entry.path());
+        }
+    }
+
+    void FileWatcher::Run()
+    {
+        alignas(inotify_event) char buffer[4096];
+        Set<Path> changedFiles;
+        while (!m_Stop)
+        {
+            pollfd pollFd {m_NotifyFd, POLLIN, 0};
+            const i32 ready = poll(&pollFd, 1, DebounceMilliseconds);
+            if (ready > 0 && (pollFd.revents & POLLIN))
+            {
+                ssize_t length;
+                while ((length = read(m_NotifyFd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (const char* ptr = buffer; ptr < buffer + length;)
+                    {
+                        const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                        ptr += sizeof(inotify_event) + event->len;
+
+                        const auto it = m_WatchDirs.find(event->wd);
+                        if (it == m_WatchDirs.end() || event->len == 0)
+                            continue;
+
+                        const Path path = it->second / event->name;
+                        if (event->mask & IN_ISDIR)
+                        {
+                            // 新建的子目录也需要监视
+                            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                                AddWatch(path);
+                            continue;
+                        }
+                        // IN_CREATE之后通常还会有IN_CLOSE_WRITE，只有写完的文件才需要处理
+                        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                            changedFiles.insert(path);
+                    }
+                }
+                continue;
+            }
+
+            // 超时且有积累的修改，说明修改已经安静下来
+            if (ready == 0 && !changedFiles.empty())
+            {
+                m_Callback(changedFiles);
+                changedFiles.clear();
+            }
+        }
+    }
+#else
+    Set<Path> FileWatcher::Scan(const bool reportNewFiles)
+    {
+        Set<Path> changedFiles;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(m_Directory, error))
+        {
+            if (!entry.is_regular_file(error))
+                continue;
+
+            const auto writeTime = entry.last_write_time(error);
+            if (error)
+                continue;
+
+            auto [it, inserted] = m_WriteTimes.try_emplace(entry.path(), writeTime);
+            if (!inserted && it->second != writeTime)
+            {
+                it->second = writeTime;
+                changedFiles.insert(entry.path());
+            }
+            else if (inserted && reportNewFiles)
+            {
+                changedFiles.insert(entry.path());
+            }
+        }
+        return changedFiles;
+    }
+
+    void FileWatcher::Run()
+    {
+        Set<Path> changedFiles;
+        while (!m_Stop)
+        {
+            {
+                std::unique_lock lock(m_StopMutex);
+                m_StopCondition.wait_for(lock, std::chrono::milliseconds(changedFiles.empty() ? PollMilliseconds : DebounceMilliseconds),
+                    [this] { return m_Stop.load(); });
+            }
+            if (m_Stop)
+                break;
+
+            Set<Path> scanned = Scan(true);
+            if (!scanned.empty())
+            {
+                changedFiles.merge(scanned);
+                continue;
+            }
+            if (!changedFiles.empty())
+            {
+                m_Callback(changedFiles);
+                changedFiles.clear();
+            }
+        }
+    }
+#endif
+}
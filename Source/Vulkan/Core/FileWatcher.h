@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "BaseType.h"
+#include "FileSystem.h"
+
+namespace File
+{
+    /**
+     * @class FileWatcher
+     * @brief 目录修改监视器
+     * @details
+     * 在独立线程中递归监视目录，文件被写入、创建或移入时回调 \n
+     * Linux使用inotify，其他平台按固定间隔轮询修改时间 \n
+     * 短时间内的多次修改会被合并，安静一段时间后才批量回调，避免编辑器保存时的重复事件 \n
+     * 回调在监视线程中执行，不要在回调里做耗时操作
+     */
+    class FileWatcher
+    {
+    public:
+        using Callback = Function<void(const Set<Path>& changedFiles)>;
+
+        FileWatcher(const Path& directory, Callback callback);
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        const Path& GetDirectory() const { return m_Directory; }
+
+    private:
+        void Run();
+#ifdef PL_PLAT_LINUX
+        // 递归添加目录监视
+        void AddWatch(const Path& directory);
+#else
+        // 扫描目录，返回修改时间变化的文件，reportNewFiles为true时新出现的文件也算作修改
+        Set<Path> Scan(bool reportNewFiles);
+#endif
+
+    private:
+        static constexpr i32 DebounceMilliseconds = 100;   ///< 事件合并时间
+        static constexpr i32 PollMilliseconds = 250;       ///< 轮询间隔
+
+        Path m_Directory;                   ///< 监视的目录
+        Callback m_Callback;                ///< 修改回调
+        std::thread m_Thread;               ///< 监视线程
+        std::atomic<bool> m_Stop {false};   ///< 是否停止
+#ifdef PL_PLAT_LINUX
+        i32 m_NotifyFd {-1};                ///< inotify句柄
+        UMap<i32, Path> m_WatchDirs;        ///< 监视描述符 -> 目录
+#else
+        Map<Path, std::filesystem::file_time_type> m_WriteTimes;   ///< 文件 -> 上次修改时间
+        std::mutex m_StopMutex;                                    ///< 配合停止条件使用
+        std::condition_variable m_StopCondition;                   ///< 停止时唤醒轮询
+#endif
+    };
+}
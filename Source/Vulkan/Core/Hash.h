@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include <cstring>
+
+#include "BaseType.h"
+
+/**
+ * @brief 快速非加密哈希
+ * @details
+ * 基于XXH64算法，用于缓存键、内容寻址等场景 \n
+ * 结果在不同平台和不同运行间保持稳定，可以持久化到磁盘
+ */
+namespace Hash
+{
+    namespace Detail
+    {
+        constexpr u64 Prime1 = 11400714785074694791ULL;
+        constexpr u64 Prime2 = 14029467366897019727ULL;
+        constexpr u64 Prime3 = 1609587929392839161ULL;
+        constexpr u64 Prime4 = 9650029242287828579ULL;
+        constexpr u64 Prime5 = 2870177450012600261ULL;
+
+        inline u64 RotL(const u64 x, const int r) { return (x << r) | (x >> (64 - r)); }
+
+        inline u64 Read64(const u8* p) { u64 v; std::memcpy(&v, p, sizeof(v)); return v; }
+        inline u32 Read32(const u8* p) { u32 v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+        inline u64 Round(u64 acc, const u64 input)
+        {
+            acc += input * Prime2;
+            acc  = RotL(acc, 31);
+            return acc * Prime1;
+        }
+
+        inline u64 MergeRound(u64 acc, const u64 val)
+        {
+            acc ^= Round(0, val);
+            return acc * Prime1 + Prime4;
+        }
+    }
+
+    /** 计算一段内存的64位哈希 */
+    inline u64 Hash64(const void* data, const size_t size, const u64 seed = 0)
+    {
+        using namespace Detail;
+        const u8* p   = static_cast<const u8*>(data);
+        const u8* end = p + size;
+        u64 h;
+
+        if (size >= 32)
+        {
+            const u8* limit = end - 32;
+            u64 v1 = seed + Prime1 + Prime2;
+            u64 v2 = seed + Prime2;
+            u64 v3 = seed;
+            u64 v4 = seed - Prime1;
+            do
+            {
+                v1 = Round(v1, Read64(p));      p += 8;
+                v2 = Round(v2, Read64(p));      p += 8;
+                v3 = Round(v3, Read64(p));      p += 8;
+                v4 = Round(v4, Read64(p));      p += 8;
+            } while (p <= limit);
+
+            h = RotL(v1, 1) + RotL(v2, 7) + RotL(v3, 12) + RotL(v4, 18);
+            h = MergeRound(h, v1);
+            h = MergeRound(h, v2);
+            h = MergeRound(h, v3);
+            h = MergeRound(h, v4);
+        }
+        else
+        {
+            h = seed + Prime5;
+        }
+
+        h += static_cast<u64>(size);
+
+        while (p + 8 <= end)
+        {
+            h ^= Round(0, Read64(p));
+            h  = RotL(h, 27) * Prime1 + Prime4;
+            p += 8;
+        }
+        if (p + 4 <= end)
+        {
+            h ^= static_cast<u64>(Read32(p)) * Prime1;
+            h  = RotL(h, 23) * Prime2 + Prime3;
+            p += 4;
+        }
+        while (p < end)
+        {
+            h ^= (*p) * Prime5;
+            h  = RotL(h, 11) * Prime1;
+            ++p;
+        }
+
+        h ^= h >> 33;
+        h *= Prime2;
+        h ^= h >> 29;
+        h *= Prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    /** 计算字符串的64位哈希 */
+    inline u64 Hash64(const StringView str, const u64 seed = 0)
+    {
+        return Hash64(str.data(), str.size(), seed);
+    }
+
+    /** 将一个值混入已有的64位哈希 */
+    inline u64 Combine64(const u64 seed, const u64 value)
+    {
+        return Hash64(&value, sizeof(value), seed);
+    }
+
+    /** 将64位哈希转换为16位定长的十六进制字符串 */
+    inline String ToHexString(const u64 hash)
+    {
+        constexpr char digits[] = "0123456789abcdef";
+        String result(16, '0');
+        for (int i = 15; i >= 0; --i)
+        {
+            result[i] = digits[(hash >> ((15 - i) * 4)) & 0xF];
+        }
+        return result;
+    }
+}
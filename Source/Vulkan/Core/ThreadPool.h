@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "BaseType.h"
+
+/**
+ * @class ThreadPool
+ * @brief 固定大小的线程池
+ * @details
+ * 任务按提交顺序被空闲的工作线程取走执行，Submit返回std::future用于获取结果 \n
+ * 任务内部不要等待同一线程池中其他任务的future，否则所有工作线程都可能被阻塞
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(u32 threadCount = std::thread::hardware_concurrency())
+    {
+        threadCount = std::max(threadCount, 1u);
+        m_Workers.reserve(threadCount);
+        for (u32 i {0}; i < threadCount; ++i)
+        {
+            m_Workers.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Condition.notify_all();
+        for (auto& worker : m_Workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** 提交任务 */
+    template<typename F, typename... Args>
+    auto Submit(F&& func, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>>
+    {
+        using ReturnType = std::invoke_result_t<F, Args...>;
+        auto task = MakeShared<std::packaged_task<ReturnType()>>(
+            std::bind(std::forward<F>(func), std::forward<Args>(args)...));
+        std::future<ReturnType> result = task->get_future();
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Tasks.emplace_back([task] { (*task)(); });
+        }
+        m_Condition.notify_one();
+        return result;
+    }
+
+    /** 获取工作线程数量 */
+    u32 GetThreadCount() const { return static_cast<u32>(m_Workers.size()); }
+
+private:
+    void WorkerLoop()
+    {
+        while (true)
+        {
+            Function<void()> task;
+            {
+                std::unique_lock lock(m_Mutex);
+                m_Condition.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+                if (m_Stop && m_Tasks.empty())
+                    return;
+                task = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+private:
+    Vector<std::thread> m_Workers;             ///< 工作线程
+    Deque<Function<void()>> m_Tasks;           ///< 等待执行的任务
+    std::mutex m_Mutex;                        ///< 保护任务队列
+    std::condition_variable m_Condition;       ///< 任务到达或停止时唤醒工作线程
+    bool m_Stop {false};                       ///< 是否停止
+};
@@ -0,0 +1,185 @@
+﻿#include "ShaderArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "ShaderCache.h"
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+bool ShaderArchive::Open(const File::Path& path)
+{
+    Close();
+    if (!m_File.Open(path))
+        return false;
+
+    const Span<const u8> data = m_File.GetSpan();
+    if (data.size() < sizeof(ShaderArchiveHeader))
+    {
+        Log::CatWarn("Shader", "Shader archive '{0}' is truncated", path.string());
+        Close();
+        return false;
+    }
+
+    ShaderArchiveHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    const u64 indexSize = static_cast<u64>(header.EntryCount) * sizeof(ShaderArchiveEntry);
+    if (header.Magic != Magic || header.Version != Version || header.DataSize != data.size() ||
+        header.IndexOffset % alignof(ShaderArchiveEntry) != 0 || header.IndexOffset > data.size() || indexSize > data.size() - header.IndexOffset)
+    {
+        Log::CatWarn("Shader", "Shader archive '{0}' has an invalid header", path.string());
+        Close();
+        return false;
+    }
+
+    m_Entries = {reinterpret_cast<const ShaderArchiveEntry*>(data.data() + header.IndexOffset), header.EntryCount};
+    for (const ShaderArchiveEntry& entry : m_Entries)
+    {
+        // 先比较偏移再比较剩余大小，损坏的偏移加上大小不会溢出绕过检查；Find按u32返回数据，大小必须是4的倍数
+        if (entry.Offset % BlobAlignment != 0 || entry.Offset > data.size() || entry.Size > data.size() - entry.Offset ||
+            entry.Size % sizeof(u32) != 0)
+        {
+            Log::CatWarn("Shader", "Shader archive '{0}' has an invalid entry", path.string());
+            Close();
+            return false;
+        }
+    }
+
+    // Find按键二分查找，键必须严格递增
+    const auto unordered = std::adjacent_find(m_Entries.begin(), m_Entries.end(),
+        [](const ShaderArchiveEntry& lhs, const ShaderArchiveEntry& rhs) { return lhs.Key >= rhs.Key; });
+    if (unordered != m_Entries.end())
+    {
+        Log::CatWarn("Shader", "Shader archive '{0}' has an unsorted index", path.string());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ShaderArchive::Close()
+{
+    m_Entries = {};
+    m_File.Close();
+}
+
+Span<const u32> ShaderArchive::Find(const u64 key) const
+{
+    const auto it = std::lower_bound(m_Entries.begin(), m_Entries.end(), key,
+        [](const ShaderArchiveEntry& entry, const u64 value) { return entry.Key < value; });
+    if (it == m_Entries.end() || it->Key != key)
+        return {};
+
+    return {reinterpret_cast<const u32*>(m_File.GetData() + it->Offset), it->Size / sizeof(u32)};
+}
+
+bool ShaderArchive::Write(const File::Path& path, const Map<u64, SPIRVBinary>& entries)
+{
+    // Map按键有序，索引直接按遍历顺序写出即为排序结果
+    Vector<ShaderArchiveEntry> index;
+    index.reserve(entries.size());
+
+    ShaderArchiveHeader header;
+    header.Magic       = Magic;
+    header.Version     = Version;
+    header.EntryCount  = static_cast<u32>(entries.size());
+    header.IndexOffset = sizeof(ShaderArchiveHeader);
+
+    // 内容相同的条目(例如同一份二进制的多个查找键)共享一个数据块
+    struct Blob
+    {
+        u64 Offset {0};
+        const SPIRVBinary* Binary {nullptr};
+    };
+    Vector<Blob> blobs;
+    UMap<u64, size_t> blobByHash;
+
+    u64 offset = AlignUp<u64>(header.IndexOffset + entries.size() * sizeof(ShaderArchiveEntry), BlobAlignment);
+    for (const auto& [key, binary] : entries)
+    {
+        const u64 contentHash = Hash::Hash64(binary.data(), binary.size() * sizeof(u32));
+        auto [it, inserted] = blobByHash.try_emplace(contentHash, blobs.size());
+        if (!inserted && *blobs[it->second].Binary != binary)
+        {
+            inserted = true;
+            it->second = blobs.size();
+        }
+        if (inserted)
+        {
+            blobs.push_back({offset, &binary});
+            offset = AlignUp<u64>(offset + binary.size() * sizeof(u32), BlobAlignment);
+        }
+
+        ShaderArchiveEntry& entry = index.emplace_back();
+        entry.Key    = key;
+        entry.Offset = blobs[it->second].Offset;
+        entry.Size   = static_cast<u32>(binary.size() * sizeof(u32));
+    }
+    header.DataSize = offset;
+
+    File::Path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            Log::CatError("Shader", "Could not write shader archive '{0}'", tempPath.string());
+            return false;
+        }
+
+        constexpr char padding[BlobAlignment] {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(ShaderArchiveEntry)));
+
+        u64 written = header.IndexOffset + index.size() * sizeof(ShaderArchiveEntry);
+        for (const Blob& blob : blobs)
+        {
+            const u64 size = blob.Binary->size() * sizeof(u32);
+            out.write(padding, static_cast<std::streamsize>(blob.Offset - written));
+            out.write(reinterpret_cast<const char*>(blob.Binary->data()), static_cast<std::streamsize>(size));
+            written = blob.Offset + size;
+        }
+        out.write(padding, static_cast<std::streamsize>(header.DataSize - written));
+
+        if (!out.flush())
+        {
+            Log::CatError("Shader", "Could not write shader archive '{0}'", tempPath.string());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        Log::CatError("Shader", "Could not replace shader archive '{0}': {1}", path.string(), error.message());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool ShaderArchive::PackCacheDir(const File::Path& cacheDir, const File::Path& archivePath)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(cacheDir, error))
+        return false;
+
+    Map<u64, SPIRVBinary> entries;
+    for (const auto& dirEntry : std::filesystem::directory_iterator(cacheDir, error))
+    {
+        if (!dirEntry.is_regular_file())
+            continue;
+
+        ShaderCacheHeader header;
+        SPIRVBinary binary;
+        if (ShaderCache::ReadEntry(dirEntry.path(), header, binary))
+        {
+            entries[header.Key] = std::move(binary);
+        }
+    }
+
+    Log::CatInfo("Shader", "Packing {0} shader cache entries into '{1}'", entries.size(), archivePath.string());
+    return Write(archivePath, entries);
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include "ShaderUtils.h"
+#include "Core/BaseType.h"
+#include "Core/FileSystem.h"
+
+/**
+ * @brief Shader归档文件头
+ * @details
+ * 归档布局: [文件头][按键排序的索引][对齐的SPIR-V数据块...] \n
+ * 每个数据块按BlobAlignment对齐，映射后可直接作为VkShaderModuleCreateInfo::pCode使用
+ */
+struct ShaderArchiveHeader
+{
+    u32 Magic {0};          ///< 魔数
+    u32 Version {0};        ///< 归档格式版本
+    u32 EntryCount {0};     ///< 条目数量
+    u32 Reserved {0};       ///< 保留
+    u64 IndexOffset {0};    ///< 索引偏移
+    u64 DataSize {0};       ///< 文件总大小，用于校验截断
+};
+PL_STATIC_ASSERT(sizeof(ShaderArchiveHeader) == 32, "ShaderArchiveHeader layout changed!");
+
+/** @brief Shader归档索引条目 */
+struct ShaderArchiveEntry
+{
+    u64 Key {0};            ///< 缓存键
+    u64 Offset {0};         ///< 数据块偏移
+    u32 Size {0};           ///< 数据块字节数
+    u32 Reserved {0};       ///< 保留
+};
+PL_STATIC_ASSERT(sizeof(ShaderArchiveEntry) == 24, "ShaderArchiveEntry layout changed!");
+
+/**
+ * @class ShaderArchive
+ * @brief 打包的SPIR-V缓存归档
+ * @details
+ * 将所有缓存条目合并为一个文件，打开时整体内存映射一次 \n
+ * 查找为索引上的二分查找，返回的数据直接指向映射内存，不产生拷贝 \n
+ * 内容相同的条目共享同一个数据块 \n
+ * 打开后为只读，可被多个线程同时查找
+ */
+class ShaderArchive
+{
+public:
+    static constexpr u32 Magic         = 0x41534C50; // "PLSA"
+    static constexpr u32 Version       = 1;
+    static constexpr u32 BlobAlignment = 16;
+
+    // 打开归档，格式不正确或索引未按键严格递增时返回false
+    bool Open(const File::Path& path);
+
+    // 关闭归档
+    void Close();
+
+    // 按缓存键查找SPIR-V，未找到时返回空
+    Span<const u32> Find(u64 key) const;
+
+    bool IsOpen() const { return m_File.IsOpen(); }
+    u32 GetEntryCount() const { return static_cast<u32>(m_Entries.size()); }
+
+    // 写入归档
+    static bool Write(const File::Path& path, const Map<u64, SPIRVBinary>& entries);
+
+    // 将松散的缓存目录打包为归档
+    static bool PackCacheDir(const File::Path& cacheDir, const File::Path& archivePath);
+
+private:
+    File::MappedFile m_File;                    ///< 映射的归档文件
+    Span<const ShaderArchiveEntry> m_Entries;   ///< 指向映射内存中的索引
+};
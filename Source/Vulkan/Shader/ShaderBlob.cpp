@@ -0,0 +1,127 @@
+﻿#include "ShaderBlob.h"
+
+#include <algorithm>
+#include <ranges>
+
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+ShaderBlob::~ShaderBlob()
+{
+    DestroyModule();
+}
+
+VkShaderModule ShaderBlob::GetModule(const VkDevice device) const
+{
+    std::lock_guard lock(m_ModuleMutex);
+    if (m_Module != VK_NULL_HANDLE)
+    {
+        PL_ASSERT(m_Device == device, "ShaderBlob module was created on another device!");
+        return m_Module;
+    }
+
+    VkShaderModuleCreateInfo createInfo {};
+    createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = m_View.size() * sizeof(u32);
+    createInfo.pCode    = m_View.data();
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &m_Module) != VK_SUCCESS)
+    {
+        Log::CatError("Shader", "Failed to create shader module for blob {0}", Hash::ToHexString(m_Hash));
+        m_Module = VK_NULL_HANDLE;
+        return VK_NULL_HANDLE;
+    }
+    m_Device = device;
+    return m_Module;
+}
+
+void ShaderBlob::DestroyModule() const
+{
+    std::lock_guard lock(m_ModuleMutex);
+    if (m_Module != VK_NULL_HANDLE)
+        vkDestroyShaderModule(m_Device, m_Module, nullptr);
+    m_Module = VK_NULL_HANDLE;
+    m_Device = VK_NULL_HANDLE;
+}
+
+ShaderBlobPool& ShaderBlobPool::Get()
+{
+    static ShaderBlobPool pool;
+    return pool;
+}
+
+template<typename Create>
+SharedPtr<const ShaderBlob> ShaderBlobPool::InternLocked(const u64 hash, const Span<const u32> code, Create&& create, SharedPtr<const ShaderBlob>& existing)
+{
+    WeakPtr<const ShaderBlob>& slot = m_Blobs[hash];
+    if (existing = slot.lock(); existing)
+    {
+        if (std::ranges::equal(existing->GetCode(), code))
+            return existing;
+
+        // 哈希冲突时不共享，保留池中已有的二进制
+        Log::CatWarn("Shader", "SPIR-V hash collision on {0}, blob is not shared", Hash::ToHexString(hash));
+        return SharedPtr<const ShaderBlob>(create());
+    }
+
+    SharedPtr<const ShaderBlob> blob(create(), [this](const ShaderBlob* released)
+    {
+        Release(const_cast<ShaderBlob*>(released));
+    });
+    slot = blob;
+    return blob;
+}
+
+SharedPtr<const ShaderBlob> ShaderBlobPool::Intern(SPIRVBinary code)
+{
+    const u64 hash = Hash::Hash64(code.data(), code.size() * sizeof(u32));
+
+    // 在锁外析构，最后一个引用在这里释放时删除器需要再次加锁
+    SharedPtr<const ShaderBlob> existing;
+    std::lock_guard lock(m_Mutex);
+    return InternLocked(hash, code, [&] { return new ShaderBlob(hash, std::move(code)); }, existing);
+}
+
+SharedPtr<const ShaderBlob> ShaderBlobPool::Intern(const Span<const u32> mapped)
+{
+    const u64 hash = Hash::Hash64(mapped.data(), mapped.size() * sizeof(u32));
+
+    SharedPtr<const ShaderBlob> existing;
+    std::lock_guard lock(m_Mutex);
+    return InternLocked(hash, mapped, [&] { return new ShaderBlob(hash, mapped); }, existing);
+}
+
+void ShaderBlobPool::Release(ShaderBlob* blob)
+{
+    {
+        // 释放期间其他线程可能已用新实例占据了该槽位，只移除已过期的槽位
+        std::lock_guard lock(m_Mutex);
+        if (const auto it = m_Blobs.find(blob->GetHash()); it != m_Blobs.end() && it->second.expired())
+            m_Blobs.erase(it);
+    }
+    delete blob;
+}
+
+void ShaderBlobPool::DestroyModules()
+{
+    // 先在锁内取得强引用，释放引用时删除器需要再次加锁
+    Vector<SharedPtr<const ShaderBlob>> blobs;
+    {
+        std::lock_guard lock(m_Mutex);
+        blobs.reserve(m_Blobs.size());
+        for (const WeakPtr<const ShaderBlob>& slot : m_Blobs | std::views::values)
+        {
+            if (SharedPtr<const ShaderBlob> blob = slot.lock())
+                blobs.push_back(std::move(blob));
+        }
+    }
+    for (const SharedPtr<const ShaderBlob>& blob : blobs)
+    {
+        blob->DestroyModule();
+    }
+}
+
+size_t ShaderBlobPool::GetBlobCount() const
+{
+    std::lock_guard lock(m_Mutex);
+    return m_Blobs.size();
+}
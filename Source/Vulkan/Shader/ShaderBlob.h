@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <mutex>
+
+#include "ShaderUtils.h"
+#include "Core/BaseType.h"
+
+/**
+ * @class ShaderBlob
+ * @brief 内容寻址的SPIR-V二进制
+ * @details
+ * 由ShaderBlobPool创建，内容相同的阶段二进制在所有shader之间共享同一个实例 \n
+ * 可以持有自己的二进制，也可以直接引用映射的归档，引用归档时不复制数据 \n
+ * VkShaderModule在第一次请求时创建并随实例共享，最后一个引用释放时一起销毁
+ */
+class ShaderBlob
+{
+public:
+    ShaderBlob(u64 hash, SPIRVBinary code) : m_Hash(hash), m_Code(std::move(code)), m_View(m_Code) {}
+    ShaderBlob(u64 hash, Span<const u32> mapped) : m_Hash(hash), m_View(mapped) {}
+    ~ShaderBlob();
+
+    ShaderBlob(const ShaderBlob&) = delete;
+    ShaderBlob& operator=(const ShaderBlob&) = delete;
+
+    u64 GetHash() const { return m_Hash; }
+    Span<const u32> GetCode() const { return m_View; }
+
+    /** 是否引用映射内存，引用时归档需要在二进制释放前保持挂载 */
+    bool IsMapped() const { return m_Code.empty() && !m_View.empty(); }
+
+    /** 获取VkShaderModule，第一次调用时创建，失败时返回VK_NULL_HANDLE */
+    VkShaderModule GetModule(VkDevice device) const;
+
+    /** 销毁已创建的VkShaderModule，下次请求时重新创建 */
+    void DestroyModule() const;
+
+private:
+    u64 m_Hash {0};                                 ///< 内容哈希
+    SPIRVBinary m_Code;                             ///< 持有的SPIR-V二进制，引用映射内存时为空
+    Span<const u32> m_View;                         ///< 指向m_Code或映射内存
+    mutable VkShaderModule m_Module {VK_NULL_HANDLE}; ///< 共享的着色器模块
+    mutable VkDevice m_Device {VK_NULL_HANDLE};     ///< 创建模块的设备
+    mutable std::mutex m_ModuleMutex;               ///< 保护模块的创建和销毁
+};
+
+/**
+ * @class ShaderBlobPool
+ * @brief SPIR-V去重池
+ * @details
+ * 以内容哈希为键弱引用所有存活的ShaderBlob，相同内容的二进制只保存一份 \n
+ * 池本身不延长二进制的生命周期，没有shader引用的二进制及其模块会立即释放 \n
+ * 所有接口线程安全
+ */
+class ShaderBlobPool
+{
+public:
+    /** 获取单例 */
+    static ShaderBlobPool& Get();
+
+    /** 获取与code内容相同的共享二进制，不存在时创建 */
+    SharedPtr<const ShaderBlob> Intern(SPIRVBinary code);
+
+    /** 与Intern相同，新建的二进制直接引用mapped指向的内存，不复制，mapped需要在二进制释放前保持有效 */
+    SharedPtr<const ShaderBlob> Intern(Span<const u32> mapped);
+
+    /** 销毁所有存活二进制的VkShaderModule，需要在销毁设备前调用 */
+    void DestroyModules();
+
+    /** 当前存活的二进制数量 */
+    size_t GetBlobCount() const;
+
+private:
+    // 查找内容相同的二进制，没有时用create创建并登记，需要持有锁，existing需要在锁外析构
+    template<typename Create>
+    SharedPtr<const ShaderBlob> InternLocked(u64 hash, Span<const u32> code, Create&& create, SharedPtr<const ShaderBlob>& existing);
+
+    // 最后一个引用释放时由删除器调用
+    void Release(ShaderBlob* blob);
+
+private:
+    UMap<u64, WeakPtr<const ShaderBlob>> m_Blobs;   ///< 内容哈希 -> 二进制
+    mutable std::mutex m_Mutex;                     ///< 保护m_Blobs
+};
@@ -0,0 +1,302 @@
+﻿#include "ShaderCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "Core/Compression.h"
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+#ifndef PL_SHADER_NO_COMPILER
+    #include <glslang/build_info.h>
+    #include <spirv-tools/libspirv.h>
+#endif
+
+#ifndef PL_SHADER_NO_COMPILER
+u64 ShaderCache::ComputeKey(const ShaderCacheKeyDesc& desc)
+{
+    u64 key = Hash::Hash64(desc.Source);
+    key = Hash::Combine64(key, static_cast<u64>(desc.Stage));
+    key = Hash::Combine64(key, static_cast<u64>(desc.TargetEnv));
+    key = Hash::Combine64(key, desc.TargetEnvVersion);
+    key = Hash::Combine64(key, static_cast<u64>(desc.OptimizationLevel));
+    key = Hash::Combine64(key, static_cast<u64>(desc.Profile));
+    key = Hash::Combine64(key, desc.DependencyHash);
+    key = Hash::Combine64(key, desc.VariantHash);
+    key = Hash::Combine64(key, GetCompilerVersion());
+    return key;
+}
+
+u64 ShaderCache::ComputeSlot(const ShaderCacheKeyDesc& desc, const File::Path& sourcePath)
+{
+    u64 slot = Hash::Hash64(StringView(std::filesystem::absolute(sourcePath).lexically_normal().generic_string()));
+    slot = Hash::Combine64(slot, static_cast<u64>(desc.Stage));
+    slot = Hash::Combine64(slot, static_cast<u64>(desc.TargetEnv));
+    slot = Hash::Combine64(slot, static_cast<u64>(desc.Profile));
+    slot = Hash::Combine64(slot, desc.VariantHash);
+    // 0表示不参与清理
+    return slot != 0 ? slot : 1;
+}
+
+u64 ShaderCache::GetCompilerVersion()
+{
+    // 产物由glslang编译、SPIRV-Tools优化，两者任一升级都可能改变结果，版本号都参与缓存键
+    static const u64 version = []
+    {
+        u64 hash = Hash::Hash64(StringView("ShaderCompiler"));
+        hash = Hash::Combine64(hash, Version);
+
+        // glslang的版本只在构建时以宏的形式提供
+        hash = Hash::Combine64(hash, GLSLANG_VERSION_MAJOR);
+        hash = Hash::Combine64(hash, GLSLANG_VERSION_MINOR);
+        hash = Hash::Combine64(hash, GLSLANG_VERSION_PATCH);
+        hash = Hash::Combine64(hash, Hash::Hash64(StringView(GLSLANG_VERSION_FLAVOR)));
+
+        // SPIRV-Tools的版本字符串包含发布号和提交信息
+        hash = Hash::Combine64(hash, Hash::Hash64(StringView(spvSoftwareVersionDetailsString())));
+
+        // 生成的SPIR-V版本
+        unsigned int spvVersion {0};
+        unsigned int spvRevision {0};
+        shaderc_get_spv_version(&spvVersion, &spvRevision);
+        hash = Hash::Combine64(hash, spvVersion);
+        hash = Hash::Combine64(hash, spvRevision);
+        return hash;
+    }();
+    return version;
+}
+#endif
+
+String ShaderCache::GetAssetName(const File::Path& path)
+{
+    return std::filesystem::absolute(path).lexically_normal().lexically_relative(GetProjectDir()).generic_string();
+}
+
+u64 ShaderCache::ComputeBakedKey(const StringView assetName, const ShaderStage stage, const u64 variantHash)
+{
+    u64 key = Hash::Hash64(StringView("ShaderBaked"));
+    key = Hash::Combine64(key, Version);
+    key = Hash::Combine64(key, Hash::Hash64(assetName));
+    key = Hash::Combine64(key, static_cast<u64>(stage));
+    key = Hash::Combine64(key, variantHash);
+    return key;
+}
+
+bool ShaderCache::LoadBaked(const StringView assetName, const u64 variantHash, SPIRVBinaryViews& outBinaries)
+{
+    constexpr ShaderStage stages[] = {ShaderStage::Vertex, ShaderStage::Fragment, ShaderStage::Compute,
+        ShaderStage::Geometry, ShaderStage::TessControl, ShaderStage::TessEvaluation};
+
+    outBinaries.clear();
+    for (const ShaderStage stage : stages)
+    {
+        if (const Span<const u32> mapped = FindMapped(ComputeBakedKey(assetName, stage, variantHash)); !mapped.empty())
+            outBinaries[stage] = mapped;
+    }
+    return !outBinaries.empty();
+}
+
+File::Path ShaderCache::GetEntryPath(const String& shaderName, const u64 key, const Str extension)
+{
+    return GetCacheDir() / (shaderName + "." + Hash::ToHexString(key) + extension);
+}
+
+bool ShaderCache::Load(const File::Path& path, const u64 key, SPIRVBinary& outBinary)
+{
+    if (const Span<const u32> mapped = FindMapped(key); !mapped.empty())
+    {
+        outBinary.assign(mapped.begin(), mapped.end());
+        return true;
+    }
+
+    ShaderCacheHeader header;
+    SPIRVBinary binary;
+    if (!ReadEntry(path, header, binary))
+        return false;
+
+    if (header.Key != key)
+    {
+        Log::CatWarn("Shader", "Shader cache entry '{0}' is stale, recompiling", path.string());
+        return false;
+    }
+
+    outBinary = std::move(binary);
+    return true;
+}
+
+bool ShaderCache::ReadEntry(const File::Path& path, ShaderCacheHeader& outHeader, SPIRVBinary& outBinary)
+{
+    // 映射后直接在映射上校验，只有校验通过的数据才复制出来
+    const File::MappedFile file(path);
+    if (!file.IsOpen() || file.GetSize() < sizeof(ShaderCacheHeader))
+        return false;
+
+    ShaderCacheHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (header.Magic != Magic)
+        return false;
+
+    const bool compressed = header.Flags & ShaderCacheFlags::CompressedLZ4;
+    if (header.Version != Version || header.PayloadSize == 0 || (header.Flags & ~ShaderCacheFlags::All) != 0 ||
+        (!compressed && header.PayloadSize % sizeof(u32) != 0))
+    {
+        Log::CatWarn("Shader", "Shader cache entry '{0}' has an outdated format", path.string());
+        return false;
+    }
+
+    const u8* payload = file.GetData() + sizeof(header);
+    if (file.GetSize() - sizeof(header) < header.PayloadSize ||
+        Hash::Hash64(payload, header.PayloadSize) != header.PayloadHash)
+    {
+        Log::CatWarn("Shader", "Shader cache entry '{0}' is corrupted, recompiling", path.string());
+        return false;
+    }
+
+    if (!compressed)
+    {
+        outBinary.resize(header.PayloadSize / sizeof(u32));
+        std::memcpy(outBinary.data(), payload, header.PayloadSize);
+    }
+    else
+    {
+        // LZ4的压缩率不超过255:1，超出该范围的原始大小一定是损坏的
+        u32 rawSize {0};
+        if (header.PayloadSize > sizeof(rawSize))
+            std::memcpy(&rawSize, payload, sizeof(rawSize));
+        const size_t blockSize = header.PayloadSize - sizeof(rawSize);
+        if (rawSize == 0 || rawSize % sizeof(u32) != 0 || rawSize / 255 > blockSize)
+        {
+            Log::CatWarn("Shader", "Shader cache entry '{0}' is corrupted, recompiling", path.string());
+            return false;
+        }
+
+        outBinary.resize(rawSize / sizeof(u32));
+        if (!Compression::DecompressLZ4({payload + sizeof(rawSize), blockSize}, {reinterpret_cast<u8*>(outBinary.data()), rawSize}))
+        {
+            Log::CatWarn("Shader", "Shader cache entry '{0}' is corrupted, recompiling", path.string());
+            outBinary.clear();
+            return false;
+        }
+    }
+
+    outHeader = header;
+    return true;
+}
+
+bool ShaderCache::Store(const File::Path& path, const u64 key, const SPIRVBinary& binary, const u64 slot)
+{
+    std::error_code error;
+    std::filesystem::create_directories(GetCacheDir(), error);
+
+    const u32 rawSize = static_cast<u32>(binary.size() * sizeof(u32));
+    Span<const u8> payload {reinterpret_cast<const u8*>(binary.data()), rawSize};
+
+    // 压缩后的数据以原始字节数开头，没有变小时按原样写入
+    Vector<u8> compressed;
+    u32 flags = ShaderCacheFlags::None;
+    if (IsCompressionEnabled())
+    {
+        compressed.resize(sizeof(rawSize));
+        std::memcpy(compressed.data(), &rawSize, sizeof(rawSize));
+        Compression::CompressLZ4(payload, compressed);
+        if (compressed.size() < rawSize)
+        {
+            payload = compressed;
+            flags  |= ShaderCacheFlags::CompressedLZ4;
+        }
+    }
+
+    ShaderCacheHeader header;
+    header.Magic       = Magic;
+    header.Version     = Version;
+    header.Key         = key;
+    header.Flags       = flags;
+    header.PayloadSize = static_cast<u32>(payload.size());
+    header.PayloadHash = Hash::Hash64(payload.data(), payload.size());
+    header.Slot        = slot;
+
+    // 临时文件名带上线程号，多个线程同时写同一条目时互不干扰
+    File::Path tempPath = path;
+    tempPath += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (out.is_open())
+        {
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(payload.data()), header.PayloadSize);
+            out.flush();
+        }
+        if (!out)
+        {
+            // 打开失败时也可能留下了空文件
+            Log::CatError("Shader", "Could not write shader cache '{0}'", tempPath.string());
+            out.close();
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        Log::CatError("Shader", "Could not replace shader cache '{0}': {1}", path.string(), error.message());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+u32 ShaderCache::Prune(const String& shaderName, const Str entryExtension, const u64 slot, const u64 keepKey)
+{
+    const StringView extension = entryExtension;
+    std::error_code error;
+    const File::Path cacheDir = GetCacheDir();
+    const String prefix = shaderName + ".";
+    const size_t entryNameSize = prefix.size() + 16 + extension.size();
+
+    u32 removed {0};
+    for (const auto& dirEntry : std::filesystem::directory_iterator(cacheDir, error))
+    {
+        // 只看<Shader名称>.<16位键><阶段后缀>，名称或后缀相近的其他条目不匹配
+        const String fileName = dirEntry.path().filename().string();
+        if (fileName.size() != entryNameSize || !fileName.starts_with(prefix) || !fileName.ends_with(extension) ||
+            fileName.find_first_not_of("0123456789abcdef", prefix.size()) != prefix.size() + 16)
+            continue;
+
+        ShaderCacheHeader header;
+        {
+            std::ifstream in(dirEntry.path(), std::ios::in | std::ios::binary);
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != Magic)
+                continue;
+        }
+
+        const bool outdated = header.Version != Version;
+        if (!outdated && (header.Slot != slot || header.Key == keepKey))
+            continue;
+
+        // 其他线程可能正在读取，删除失败时留到下次清理
+        if (std::filesystem::remove(dirEntry.path(), error))
+            ++removed;
+    }
+    return removed;
+}
+
+bool ShaderCache::MountArchive(const File::Path& path)
+{
+    if (!s_Archive.Open(path))
+        return false;
+
+    Log::CatInfo("Shader", "Mounted shader archive '{0}' with {1} entries", path.string(), s_Archive.GetEntryCount());
+    return true;
+}
+
+void ShaderCache::UnmountArchive()
+{
+    s_Archive.Close();
+}
+
+Span<const u32> ShaderCache::FindMapped(const u64 key)
+{
+    return s_Archive.IsOpen() ? s_Archive.Find(key) : Span<const u32>{};
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#ifndef PL_SHADER_NO_COMPILER
+    #include <shaderc/shaderc.hpp>
+#endif
+
+#include <atomic>
+
+#include "ShaderArchive.h"
+#include "ShaderUtils.h"
+#include "Core/BaseType.h"
+#include "Core/FileSystem.h"
+
+namespace ShaderCacheFlags
+{
+    enum ShaderCacheFlags : u32
+    {
+        None          = 0,
+        CompressedLZ4 = BIT(0),     ///< 数据为 原始字节数(u32) + LZ4块
+        All           = CompressedLZ4,
+    };
+}
+
+/**
+ * @brief Shader缓存条目头
+ * @details
+ * 每个缓存文件以该头开始，之后紧跟SPIR-V数据，Flags标记数据是否经过压缩，两种条目可以共存 \n
+ * 读取时校验魔数、版本、缓存键和数据哈希，任一不匹配都视为缓存失效 \n
+ * Slot标识条目所属的源文件、阶段、目标和变体，同一槽位只保留最新的条目
+ */
+struct ShaderCacheHeader
+{
+    u32 Magic {0};          ///< 魔数
+    u32 Version {0};        ///< 缓存格式版本
+    u64 Key {0};            ///< 缓存键
+    u32 Flags {0};          ///< 条目标记，见ShaderCacheFlags
+    u32 PayloadSize {0};    ///< 存储的数据字节数
+    u64 PayloadHash {0};    ///< 存储的数据哈希
+    u64 Slot {0};           ///< 条目槽位，为0时不参与清理
+};
+PL_STATIC_ASSERT(sizeof(ShaderCacheHeader) == 40, "ShaderCacheHeader layout changed!");
+
+#ifndef PL_SHADER_NO_COMPILER
+/**
+ * @brief 缓存键描述
+ * @details 所有会影响编译产物的输入都必须参与缓存键计算
+ */
+struct ShaderCacheKeyDesc
+{
+    StringView Source;                                                          ///< 预处理后的阶段源码
+    ShaderStage Stage {ShaderStage::None};                                      ///< Shader阶段
+    shaderc_target_env TargetEnv {shaderc_target_env_vulkan};                   ///< 目标环境
+    u32 TargetEnvVersion {0};                                                   ///< 目标环境版本
+    shaderc_optimization_level OptimizationLevel {shaderc_optimization_level_zero}; ///< 优化等级
+    ShaderCompileProfile Profile {ShaderCompileProfile::Debug};                 ///< 编译配置，决定附加的优化和剥离步骤
+    u64 DependencyHash {0};                                                     ///< 包含文件的依赖哈希
+    u64 VariantHash {0};                                                        ///< 变体宏定义哈希
+};
+#endif
+
+/**
+ * @brief SPIR-V缓存
+ * @details
+ * 缓存以内容哈希为键，源码、编译选项或编译器版本变化都会得到新的键 \n
+ * 缓存文件名为 <Shader名称>.<键><阶段后缀> \n
+ * 编译器写入新条目后删除同一槽位的旧条目，修改源码不会让缓存目录无限增长 \n
+ * 挂载归档后优先从归档查找，未命中时再读取松散的缓存文件 \n
+ * 离线预编译的归档额外以预编译查找键索引同一份数据，不带编译器的运行时只通过该键查找
+ */
+class ShaderCache
+{
+public:
+    static constexpr u32 Magic   = 0x43534C50; // "PLSC"
+    static constexpr u32 Version = 2;
+
+#ifndef PL_SHADER_NO_COMPILER
+    // 计算缓存键
+    static u64 ComputeKey(const ShaderCacheKeyDesc& desc);
+
+    // 计算条目槽位，源码和包含文件变化时保持不变，源文件、阶段、目标或变体不同时不同
+    static u64 ComputeSlot(const ShaderCacheKeyDesc& desc, const File::Path& sourcePath);
+
+    // 获取glslang、SPIRV-Tools和目标SPIR-V版本的哈希，参与缓存键计算，升级任一工具都会让旧缓存失效
+    static u64 GetCompilerVersion();
+#endif
+
+    // 获取资源名称，即相对项目目录的通用格式路径
+    static String GetAssetName(const File::Path& path);
+
+    // 计算预编译查找键，只依赖资源名称、阶段和变体，不需要源码和编译器
+    static u64 ComputeBakedKey(StringView assetName, ShaderStage stage, u64 variantHash);
+
+    // 在归档中查找预编译的Vulkan二进制，返回指向映射内存的视图，一个阶段都没有时返回false
+    static bool LoadBaked(StringView assetName, u64 variantHash, SPIRVBinaryViews& outBinaries);
+
+    // 获取缓存条目路径
+    static File::Path GetEntryPath(const String& shaderName, u64 key, Str extension);
+
+    // 读取并校验缓存条目，失败时返回false；归档命中时也复制到outBinary，供需要持有二进制的编译结果使用
+    static bool Load(const File::Path& path, u64 key, SPIRVBinary& outBinary);
+
+    // 读取缓存文件并校验格式和数据哈希，不检查缓存键
+    static bool ReadEntry(const File::Path& path, ShaderCacheHeader& outHeader, SPIRVBinary& outBinary);
+
+    // 写入缓存条目，先写临时文件再替换，避免读到写了一半的条目；失败时删除临时文件
+    static bool Store(const File::Path& path, u64 key, const SPIRVBinary& binary, u64 slot = 0);
+
+    // 删除<Shader名称>.*<阶段后缀>中与slot相同但键不是keepKey的旧条目，以及格式过期的条目，返回删除的数量
+    static u32 Prune(const String& shaderName, Str extension, u64 slot, u64 keepKey);
+
+    // 设置写入时是否压缩，默认开启；压缩后没有变小的条目仍按原样写入
+    static void SetCompressionEnabled(bool enabled) { s_CompressionEnabled.store(enabled, std::memory_order_relaxed); }
+    static bool IsCompressionEnabled() { return s_CompressionEnabled.load(std::memory_order_relaxed); }
+
+    // 挂载归档，需要在开始编译前调用
+    static bool MountArchive(const File::Path& path);
+
+    // 卸载归档，引用归档的shader需要先释放
+    static void UnmountArchive();
+
+    // 在归档中查找，返回的数据指向映射内存，卸载前有效，经ShaderBlobPool::Intern(Span)可不复制地创建VkShaderModule
+    static Span<const u32> FindMapped(u64 key);
+
+    /**
+     * @brief 设置缓存根目录
+     * @details 缓存条目、默认归档和依赖图都放在根目录下，默认为项目缓存目录下的asset，不随工作目录变化 \n
+     * 不加锁，只能在第一次编译、读取缓存或挂载归档前调用
+     */
+    static void SetRootDir(const File::Path& dir) { s_RootDir = dir; }
+    static const File::Path& GetRootDir() { return s_RootDir; }
+
+    // 获取缓存条目目录
+    static File::Path GetCacheDir() { return s_RootDir / "shader"; }
+    // 获取ShaderBaker默认输出和运行时默认挂载的归档路径
+    static File::Path GetArchivePath() { return s_RootDir / "shader.archive"; }
+    // 获取依赖图路径
+    static File::Path GetDependencyGraphPath() { return s_RootDir / "shader.dependencies"; }
+
+private:
+    static inline ShaderArchive s_Archive;                          ///< 挂载的归档
+    static inline std::atomic<bool> s_CompressionEnabled {true};    ///< 写入时是否压缩
+    static inline File::Path s_RootDir {GetProjectCacheDir() / "asset"}; ///< 缓存根目录
+};
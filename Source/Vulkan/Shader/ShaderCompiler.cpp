@@ -1,16 +1,172 @@
 ﻿#include "ShaderCompiler.h"
 
-#include <fstream>
+#include <atomic>
+#include <ranges>
 
 #include <spirv_cross/spirv_cross.hpp>
 #include <spirv_cross/spirv_glsl.hpp>
 
 #include "Core/Log/Log.h"
-#include "Core/Container/String.h"
 
 namespace Pulse
 {
-    CacheCompileResult ShaderCompiler::CacheCompile(const File::Path& filePath, u8 flags)
+    namespace
+    {
+        // Vulkan编译目标
+        constexpr u32 VulkanTargetEnvVersion = shaderc_env_version_vulkan_1_2;
+        constexpr spv_target_env VulkanOptimizerEnv = SPV_ENV_VULKAN_1_2;
+
+        // OpenGL编译目标
+        constexpr u32 OpenGLTargetEnvVersion = shaderc_env_version_opengl_4_5;
+        constexpr spv_target_env OpenGLOptimizerEnv = SPV_ENV_OPENGL_4_5;
+
+        // 调试构建默认保留调试信息，便于在图形调试工具中查看源码
+#ifdef PL_DEBUG
+        std::atomic<ShaderCompileProfile> s_CompileProfile {ShaderCompileProfile::Debug};
+#else
+        std::atomic<ShaderCompileProfile> s_CompileProfile {ShaderCompileProfile::Release};
+#endif
+
+        shaderc_optimization_level GetOptimizationLevel(const ShaderCompileProfile profile)
+        {
+            switch (profile)
+            {
+            case ShaderCompileProfile::Release: return shaderc_optimization_level_performance;
+            case ShaderCompileProfile::Size:    return shaderc_optimization_level_size;
+            default:                            return shaderc_optimization_level_zero;
+            }
+        }
+
+        void ConfigureCompileOptions(shaderc::CompileOptions& options, const shaderc_target_env targetEnv, const u32 targetEnvVersion, const ShaderCompileProfile profile)
+        {
+            options.SetTargetEnvironment(targetEnv, targetEnvVersion);
+            if (profile == ShaderCompileProfile::Debug)
+                { options.SetGenerateDebugInfo();}
+            else
+                { options.SetOptimizationLevel(GetOptimizationLevel(profile));}
+        }
+
+        constexpr StringView Whitespace = " \t\r";
+
+        StringView TrimWhitespace(StringView text)
+        {
+            const size_t begin = text.find_first_not_of(Whitespace);
+            if (begin == StringView::npos)
+                return {};
+            return text.substr(begin, text.find_last_not_of(Whitespace) - begin + 1);
+        }
+
+        // 解析 #pragma type <stage> 指令，行尾的\r按空白处理
+        bool ParseTypeDirective(const StringView line, StringView& outType)
+        {
+            constexpr StringView pragmaToken = "#pragma";
+            constexpr StringView typeToken = "type";
+
+            StringView text = TrimWhitespace(line);
+            if (!text.starts_with(pragmaToken))
+                return false;
+            text.remove_prefix(pragmaToken.size());
+            if (text.empty() || Whitespace.find(text.front()) == StringView::npos)
+                return false;
+
+            text = TrimWhitespace(text);
+            if (!text.starts_with(typeToken))
+                return false;
+            text.remove_prefix(typeToken.size());
+            if (text.empty() || Whitespace.find(text.front()) == StringView::npos)
+                return false;
+
+            outType = TrimWhitespace(text);
+            return !outType.empty();
+        }
+
+        // shaderc已按优化等级执行完整的优化管线，这里只补充它不做的剥离和清理，Debug配置不需要
+        UniquePtr<spvtools::Optimizer> MakeOptimizer(const spv_target_env targetEnv, const ShaderCompileProfile profile, String& message)
+        {
+            if (profile == ShaderCompileProfile::Debug)
+                return nullptr;
+
+            auto optimizer = MakeUnique<spvtools::Optimizer>(targetEnv);
+            optimizer->SetMessageConsumer([&message](const spv_message_level_t level, const char*, const spv_position_t&, const char* text)
+            {
+                if (level <= SPV_MSG_ERROR)
+                {
+                    message += text;
+                    message += '\n';
+                }
+            });
+            // 去除名称和行号后反射数据中的名称为空，布局信息不受影响
+            optimizer->RegisterPass(spvtools::CreateStripDebugInfoPass())
+                      .RegisterPass(spvtools::CreateStripNonSemanticInfoPass())
+                      .RegisterPass(spvtools::CreateEliminateDeadFunctionsPass())
+                      .RegisterPass(spvtools::CreateAggressiveDCEPass());
+            if (profile == ShaderCompileProfile::Size)
+                optimizer->RegisterPass(spvtools::CreateCompactIdsPass());
+            return optimizer;
+        }
+    }
+
+    ShaderCompileContext::ShaderCompileContext()
+    {
+        for (size_t i {0}; i < ProfileCount; ++i)
+        {
+            const auto profile = static_cast<ShaderCompileProfile>(i);
+
+            ShaderCompileTarget& vulkanTarget = VulkanTargets[i];
+            ConfigureCompileOptions(vulkanTarget.Options, shaderc_target_env_vulkan, VulkanTargetEnvVersion, profile);
+            vulkanTarget.Optimizer = MakeOptimizer(VulkanOptimizerEnv, profile, OptimizerMessage);
+
+            // 只有Vulkan阶段直接编译源文件，OpenGL阶段的输入是已展开的交叉编译结果
+            auto includer = MakeUnique<ShaderIncluder>();
+            vulkanTarget.Includer = includer.get();
+            vulkanTarget.Options.SetIncluder(std::move(includer));
+
+            ShaderCompileTarget& openGLTarget = OpenGLTargets[i];
+            ConfigureCompileOptions(openGLTarget.Options, shaderc_target_env_opengl, OpenGLTargetEnvVersion, profile);
+            openGLTarget.Optimizer = MakeOptimizer(OpenGLOptimizerEnv, profile, OptimizerMessage);
+        }
+    }
+
+    CacheCompileResult ShaderCompiler::TryCacheCompile(const File::Path& filePath, const u8 flags, const ShaderVariantKey& variant)
+    {
+        CacheCompileResult result;
+        if (!(flags & (ShaderAPIFlags::Vulkan | ShaderAPIFlags::OpenGL)))
+        {
+            result.ErrorMessage = "UnSupport ShaderAPI Type!";
+            return result;
+        }
+
+        ShaderPreprocessResult processResult = PreprocessShaderFile(filePath);
+        result.ShaderName = processResult.Name;
+        if (!Utils::Shader::CheckShaderPreprocessResult(processResult))
+        {
+            result.ErrorMessage = "Shader File Preprocess ERROR: " + processResult.ErrorMessage;
+            return result;
+        }
+        processResult.Variant = variant;
+
+        // 与CompileAll一样收集所有阶段的错误，任一阶段失败时不返回不完整的阶段集合
+        ShaderCompileContext& context = GetCompileContext();
+        result.Success = true;
+        for (const auto& stage : processResult.Sources | std::views::keys)
+        {
+            String errorMessage;
+            const bool success = flags & ShaderAPIFlags::Vulkan
+                ? CompileVulkanStage(processResult, stage, context, result.Sources[stage], errorMessage)
+                : CompileOpenGLStage(processResult, stage, context, result.Sources[stage], errorMessage);
+            if (!success)
+            {
+                result.Success = false;
+                result.ErrorMessage += String(Utils::Shader::ShaderStageToString(stage)) + ": " + errorMessage + "\n";
+            }
+        }
+        if (!result.Success)
+            result.Sources.clear();
+        ShaderDependencyGraph::Get().SaveIfDirty(ShaderCache::GetDependencyGraphPath());
+        return result;
+    }
+
+    CacheCompileResult ShaderCompiler::CacheCompile(const File::Path& filePath, u8 flags, const ShaderVariantKey& variant)
     {
         // 预处理
         CacheCompileResult result;
@@ -22,6 +178,7 @@ namespace Pulse
             return {};
         }
         result.ShaderName = processResult.Name;
+        processResult.Variant = variant;
         // 编译
         if (flags & ShaderAPIFlags::DirectX && flags & ShaderAPIFlags::None)
         {
@@ -31,122 +188,303 @@ namespace Pulse
         if (flags & ShaderAPIFlags::Vulkan)
         {
             result.Sources = CompileVulkanBinaries(processResult);
-            result.Success = true;
+            result.Success = !result.Sources.empty();
             return result;
         }
         if (flags & ShaderAPIFlags::OpenGL)
         {
             result.Sources = CompileOpenGLBinaries(processResult);
-            result.Success = true;
+            result.Success = !result.Sources.empty();
             return result;
         }
         return {};
     }
 
-    SPIRVBinaryDatas ShaderCompiler::CompileVulkanBinaries(const ShaderPreprocessResult& processResult)
+    Vector<CacheCompileResult> ShaderCompiler::CompileAll(const Span<const File::Path> filePaths, const u8 flags)
     {
-        shaderc::Compiler compiler;
-        shaderc::CompileOptions options;
-        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
-        constexpr bool optimize = true;
-        if (optimize)
-            { options.SetOptimizationLevel(shaderc_optimization_level_performance);}
-        File::Path cacheDir = Utils::Shader::GetShaderCacheDir();
+        Vector<ShaderCompileRequest> requests;
+        requests.reserve(filePaths.size());
+        for (const File::Path& filePath : filePaths)
+        {
+            requests.push_back({filePath, {}});
+        }
+        return CompileAll(Span<const ShaderCompileRequest>(requests), flags);
+    }
 
-        SPIRVBinaryDatas outBinaries;
-        for (auto&& [stage, source] : processResult.Sources)
+    Vector<CacheCompileResult> ShaderCompiler::CompileAll(const Span<const ShaderCompileRequest> requests, const u8 flags)
+    {
+        Vector<CacheCompileResult> results(requests.size());
+        if (!(flags & (ShaderAPIFlags::Vulkan | ShaderAPIFlags::OpenGL)))
         {
-            File::Path cachedPath = cacheDir / (processResult.Name + Utils::Shader::ShaderStageCachedVulkanFileExtension(stage));
-            std::ifstream in(cachedPath, std::ios::in | std::ios::binary);
-            if (in.is_open())
+            PL_ASSERT(false, "UnSupport ShaderAPI Type!");
+            return results;
+        }
+        ThreadPool& threadPool = GetThreadPool();
+
+        // 预处理，每个请求一个任务，同一批次使用同一个编译配置
+        const ShaderCompileProfile profile = GetCompileProfile();
+        Vector<std::future<ShaderPreprocessResult>> preprocessTasks;
+        preprocessTasks.reserve(requests.size());
+        for (const ShaderCompileRequest& request : requests)
+        {
+            preprocessTasks.push_back(threadPool.Submit([&request, profile]
             {
-                in.seekg(0,std::ios::end);
-                const size_t size = in.tellg();
-                in.seekg(0,std::ios::beg);
+                ShaderPreprocessResult processResult = PreprocessShaderFile(request.FilePath);
+                processResult.Variant = request.Variant;
+                processResult.Profile = profile;
+                return processResult;
+            }));
+        }
 
-                auto& data = outBinaries[stage];
-                data.resize(size / sizeof(u32));
-                in.read(reinterpret_cast<char*>(data.data()), size);
+        Vector<ShaderPreprocessResult> processResults;
+        processResults.reserve(requests.size());
+        for (auto& task : preprocessTasks)
+        {
+            processResults.push_back(task.get());
+        }
+
+        // 编译，每个阶段一个任务，预处理结果在所有任务完成前不会被移动
+        struct StageOutput
+        {
+            SPIRVBinary Binary;
+            String ErrorMessage;
+            bool Success {false};
+        };
+        struct StageTask
+        {
+            size_t FileIndex;
+            ShaderStage Stage;
+            std::future<StageOutput> Output;
+        };
+
+        Vector<StageTask> stageTasks;
+        for (size_t i {0}; i < processResults.size(); ++i)
+        {
+            const ShaderPreprocessResult& processResult = processResults[i];
+            results[i].ShaderName = processResult.Name;
+            if (!Utils::Shader::CheckShaderPreprocessResult(processResult))
+            {
+                results[i].ErrorMessage = "Shader File Preprocess ERROR: " + processResult.ErrorMessage;
+                continue;
             }
-            else
+
+            for (const auto& stage : processResult.Sources | std::views::keys)
             {
-                shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source, Utils::Shader::GetShaderKind(stage), processResult.Name.c_str(), options);
-                if (module.GetCompilationStatus() != shaderc_compilation_status_success)
+                stageTasks.push_back({i, stage, threadPool.Submit([&processResult, stage, flags]
                 {
-                    PL_ASSERT(false, "Shader Compilation Error: " + module.GetErrorMessage());
-                    return {};
-                }
+                    // 每个工作线程使用自己的编译上下文，shaderc::Compiler不能跨线程共享
+                    ShaderCompileContext& context = GetCompileContext();
 
-                outBinaries[stage] = {module.cbegin(), module.cend()};
+                    StageOutput output;
+                    if (flags & ShaderAPIFlags::Vulkan)
+                        output.Success = CompileVulkanStage(processResult, stage, context, output.Binary, output.ErrorMessage);
+                    else
+                        output.Success = CompileOpenGLStage(processResult, stage, context, output.Binary, output.ErrorMessage);
+                    return output;
+                })});
+            }
+            results[i].Success = true;
+        }
 
-                std::ofstream out(cachedPath, std::ios::out | std::ios::binary);
-                if (out.is_open())
-                {
-                    auto& binaries = outBinaries[stage];
-                    out.write(reinterpret_cast<char*>(binaries.data()), binaries.size() * sizeof(u32));
-                    out.flush();
-                    out.close();
-                }
+        // 按提交顺序收集结果
+        for (auto& [fileIndex, stage, output] : stageTasks)
+        {
+            StageOutput stageOutput = output.get();
+            CacheCompileResult& result = results[fileIndex];
+            if (!stageOutput.Success)
+            {
+                Log::CatError("Shader", "Shader '{0}' {1} stage compilation error: {2}",
+                    result.ShaderName, Utils::Shader::ShaderStageToString(stage), stageOutput.ErrorMessage);
+                result.Success = false;
+                result.ErrorMessage += stageOutput.ErrorMessage + "\n";
+                continue;
             }
+            result.Sources[stage] = std::move(stageOutput.Binary);
         }
+
+        // 任一阶段失败时整个文件视为失败，不返回不完整的阶段集合
+        for (CacheCompileResult& result : results)
+        {
+            if (!result.Success)
+                result.Sources.clear();
+        }
+        ShaderDependencyGraph::Get().SaveIfDirty(ShaderCache::GetDependencyGraphPath());
+        return results;
+    }
+
+    SPIRVBinaryDatas ShaderCompiler::CompileVulkanBinaries(const ShaderPreprocessResult& processResult)
+    {
+        ShaderCompileContext& context = GetCompileContext();
+
+        SPIRVBinaryDatas outBinaries;
+        for (const auto& stage : processResult.Sources | std::views::keys)
+        {
+            String errorMessage;
+            if (!CompileVulkanStage(processResult, stage, context, outBinaries[stage], errorMessage))
+            {
+                PL_ASSERT(false, "Shader Compilation Error: " + errorMessage);
+                return {};
+            }
+        }
+        ShaderDependencyGraph::Get().SaveIfDirty(ShaderCache::GetDependencyGraphPath());
         return outBinaries;
     }
 
     SPIRVBinaryDatas ShaderCompiler::CompileOpenGLBinaries(const ShaderPreprocessResult& processResult)
     {
-        auto vulkanBinaryDatas = CompileVulkanBinaries(processResult);
-        shaderc::Compiler compiler;
-        shaderc::CompileOptions options;
-        options.SetTargetEnvironment(shaderc_target_env_opengl, shaderc_env_version_opengl_4_5);
-        constexpr bool optimize = false;
-        if (optimize)
-            { options.SetOptimizationLevel(shaderc_optimization_level_performance);}
-        File::Path cacheDir = Utils::Shader::GetShaderCacheDir();
+        ShaderCompileContext& context = GetCompileContext();
 
         SPIRVBinaryDatas outBinaries;
-        Map<ShaderStage, String>GLSLSources;
-
-        for (auto&& [stage, binary] : vulkanBinaryDatas)
+        for (const auto& stage : processResult.Sources | std::views::keys)
         {
-            File::Path cachedPath = cacheDir / (processResult.Name + Utils::Shader::ShaderStageCachedOpenGLFileExtension(stage));
-            std::ifstream in(cachedPath, std::ios::in | std::ios::binary);
-            if (in.is_open())
+            String errorMessage;
+            if (!CompileOpenGLStage(processResult, stage, context, outBinaries[stage], errorMessage))
             {
-                in.seekg(0,std::ios::end);
-                const size_t size = in.tellg();
-                in.seekg(0,std::ios::beg);
-
-                auto& data = outBinaries[stage];
-                data.resize(size / sizeof(u32));
-                in.read(reinterpret_cast<char*>(data.data()), size);
+                PL_ASSERT(false, "Shader Compilation Error: " + errorMessage);
+                return {};
             }
-            else
-            {
-                spirv_cross::CompilerGLSL glslCompiler(binary);
-                GLSLSources[stage] = glslCompiler.compile();
-                auto& source = GLSLSources[stage];
+        }
+        ShaderDependencyGraph::Get().SaveIfDirty(ShaderCache::GetDependencyGraphPath());
+        return outBinaries;
+    }
 
-                shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source, Utils::Shader::GetShaderKind(stage), processResult.Name.c_str());
-                if (module.GetCompilationStatus() != shaderc_compilation_status_success)
-                {
-                    PL_ASSERT(false, "Shader Compilation Error: " + module.GetErrorMessage());
-                    return {};
-                }
+    bool ShaderCompiler::CompileVulkanStage(const ShaderPreprocessResult& processResult, const ShaderStage stage,
+        ShaderCompileContext& context, SPIRVBinary& outBinary, String& outError)
+    {
+        const StringView source = processResult.Sources.at(stage);
+        ShaderDependencyGraph& dependencyGraph = ShaderDependencyGraph::Get();
+        const String unitName = ShaderDependencyGraph::MakeUnitName(processResult.FilePath, stage, processResult.Variant.GetHash());
 
-                outBinaries[stage] = {module.cbegin(), module.cend()};
+        ShaderCompileTarget& target = context.GetVulkanTarget(processResult.Profile);
+        ShaderCacheKeyDesc keyDesc {source, stage, shaderc_target_env_vulkan, VulkanTargetEnvVersion, GetOptimizationLevel(processResult.Profile), processResult.Profile};
+        keyDesc.DependencyHash = dependencyGraph.GetDependencyHash(unitName);
+        keyDesc.VariantHash    = processResult.Variant.GetHash();
+        u64 cacheKey = ShaderCache::ComputeKey(keyDesc);
+        const Str extension = Utils::Shader::ShaderStageCachedVulkanFileExtension(stage);
+        if (ShaderCache::Load(ShaderCache::GetEntryPath(processResult.Name, cacheKey, extension), cacheKey, outBinary))
+            return true;
 
-                std::ofstream out(cachedPath, std::ios::out | std::ios::binary);
-                if (out.is_open())
-                {
-                    auto& binaries = outBinaries[stage];
-                    out.write(reinterpret_cast<char*>(binaries.data()), binaries.size() * sizeof(u32));
-                    out.flush();
-                    out.close();
-                }
+        // 变体在共享选项的副本上追加宏，副本仍使用同一个包含文件解析器
+        Optional<shaderc::CompileOptions> variantOptions;
+        if (!processResult.Variant.IsEmpty())
+        {
+            variantOptions.emplace(target.Options);
+            for (const ShaderMacro& macro : processResult.Variant.GetMacros())
+            {
+                variantOptions->AddMacroDefinition(macro.Name, macro.Value);
             }
         }
-        return outBinaries;
+        const shaderc::CompileOptions& options = variantOptions ? *variantOptions : target.Options;
+
+        const String inputName = processResult.FilePath.string();
+        target.Includer->BeginCapture();
+        shaderc::SpvCompilationResult module = context.Compiler.CompileGlslToSpv(source.data(), source.size(), Utils::Shader::GetShaderKind(stage), inputName.c_str(), options);
+        const Set<File::Path> includes = target.Includer->EndCapture();
+        if (module.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            outError = module.GetErrorMessage();
+            return false;
+        }
+
+        // 包含集合可能已变化，按本次编译实际包含的文件重新计算缓存键
+        dependencyGraph.SetDependencies(unitName, includes);
+        keyDesc.DependencyHash = dependencyGraph.GetDependencyHash(unitName);
+        cacheKey = ShaderCache::ComputeKey(keyDesc);
+
+        outBinary = {module.cbegin(), module.cend()};
+        if (!RunOptimizer(target, context, outBinary, outError))
+            return false;
+        StoreAndPrune(processResult, keyDesc, cacheKey, extension, outBinary);
+        return true;
+    }
+
+    bool ShaderCompiler::CompileOpenGLStage(const ShaderPreprocessResult& processResult, const ShaderStage stage,
+        ShaderCompileContext& context, SPIRVBinary& outBinary, String& outError)
+    {
+        // OpenGL二进制由Vulkan二进制交叉编译而来，Vulkan阶段的输入同样决定了它的内容
+        ShaderDependencyGraph& dependencyGraph = ShaderDependencyGraph::Get();
+        const String unitName = ShaderDependencyGraph::MakeUnitName(processResult.FilePath, stage, processResult.Variant.GetHash());
+
+        ShaderCompileTarget& target = context.GetOpenGLTarget(processResult.Profile);
+        ShaderCacheKeyDesc keyDesc {processResult.Sources.at(stage), stage, shaderc_target_env_opengl, OpenGLTargetEnvVersion, GetOptimizationLevel(processResult.Profile), processResult.Profile};
+        keyDesc.DependencyHash = dependencyGraph.GetDependencyHash(unitName);
+        keyDesc.VariantHash    = processResult.Variant.GetHash();
+        u64 cacheKey = ShaderCache::ComputeKey(keyDesc);
+        const Str extension = Utils::Shader::ShaderStageCachedOpenGLFileExtension(stage);
+        if (ShaderCache::Load(ShaderCache::GetEntryPath(processResult.Name, cacheKey, extension), cacheKey, outBinary))
+            return true;
+
+        // 只有OpenGL缓存未命中时才需要Vulkan二进制
+        SPIRVBinary vulkanBinary;
+        if (!CompileVulkanStage(processResult, stage, context, vulkanBinary, outError))
+            return false;
+
+        // Vulkan阶段编译后依赖集合已是最新
+        keyDesc.DependencyHash = dependencyGraph.GetDependencyHash(unitName);
+        cacheKey = ShaderCache::ComputeKey(keyDesc);
 
+        spirv_cross::CompilerGLSL glslCompiler(std::move(vulkanBinary));
+        const String source = glslCompiler.compile();
+
+        shaderc::SpvCompilationResult module = context.Compiler.CompileGlslToSpv(source, Utils::Shader::GetShaderKind(stage), processResult.Name.c_str(), target.Options);
+        if (module.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            outError = module.GetErrorMessage();
+            return false;
+        }
+
+        outBinary = {module.cbegin(), module.cend()};
+        if (!RunOptimizer(target, context, outBinary, outError))
+            return false;
+        StoreAndPrune(processResult, keyDesc, cacheKey, extension, outBinary);
+        return true;
+    }
+
+    void ShaderCompiler::StoreAndPrune(const ShaderPreprocessResult& processResult, const ShaderCacheKeyDesc& keyDesc, const u64 cacheKey,
+        const Str extension, const SPIRVBinary& binary)
+    {
+        const u64 slot = ShaderCache::ComputeSlot(keyDesc, processResult.FilePath);
+        if (ShaderCache::Store(ShaderCache::GetEntryPath(processResult.Name, cacheKey, extension), cacheKey, binary, slot))
+            ShaderCache::Prune(processResult.Name, extension, slot, cacheKey);
+    }
+
+    bool ShaderCompiler::RunOptimizer(ShaderCompileTarget& target, ShaderCompileContext& context, SPIRVBinary& binary, String& outError)
+    {
+        if (!target.Optimizer)
+            return true;
+
+        SPIRVBinary optimized;
+        context.OptimizerMessage.clear();
+        if (!target.Optimizer->Run(binary.data(), binary.size(), &optimized))
+        {
+            outError = "SPIR-V optimizer error: " + context.OptimizerMessage;
+            return false;
+        }
+        binary = std::move(optimized);
+        return true;
+    }
+
+    void ShaderCompiler::SetCompileProfile(const ShaderCompileProfile profile)
+    {
+        PL_ASSERT(profile < ShaderCompileProfile::Count, "Invalid shader compile profile!");
+        s_CompileProfile.store(profile, std::memory_order_relaxed);
+    }
+
+    ShaderCompileProfile ShaderCompiler::GetCompileProfile()
+    {
+        return s_CompileProfile.load(std::memory_order_relaxed);
+    }
+
+    ShaderCompileContext& ShaderCompiler::GetCompileContext()
+    {
+        thread_local ShaderCompileContext context;
+        return context;
+    }
+
+    ThreadPool& ShaderCompiler::GetThreadPool()
+    {
+        static ThreadPool threadPool;
+        return threadPool;
     }
 
     ShaderPreprocessResult ShaderCompiler::PreprocessShaderFile(const File::Path& filePath)
@@ -155,8 +493,8 @@ namespace Pulse
         result.Success = false;
         // 获取文件扩展名
         const String ext = filePath.extension().string();
-        if (ext == ".hlsl") {result.SourceLang = Utils::Shader::SourceLang::HLSL;}
-        else if (ext == ".glsl") {result.SourceLang = Utils::Shader::SourceLang::GLSL;}
+        if (ext == ".hlsl") {result.SourceLang = ShaderSourceLang::Hlsl;}
+        else if (ext == ".glsl") {result.SourceLang = ShaderSourceLang::Glsl;}
         else
         {
             result.ErrorMessage = "Unknown shader file extension!" + ext;
@@ -164,83 +502,75 @@ namespace Pulse
         }
         // 获取文件名做为shader名称
         result.Name = filePath.stem().string();
+        result.FilePath = filePath;
+        result.Profile = GetCompileProfile();
 
-        const String shaderSource = ReadFile(filePath);
-        if (shaderSource.empty())
+        Log::CatInfo("Shader","Shader Compiler Reading File Path : {0}",filePath.string());
+        // 热重载监视的源文件可能在编译期间被编辑器截断重写，读入一份副本而不是映射
+        String text;
+        if (!File::ReadTextFile(filePath, text) || text.empty())
         {
             result.ErrorMessage = "Could not read file!";
             return result;
         }
+        result.Source = MakeShared<const String>(std::move(text));
 
-        Map <ShaderStage, String> sources;
-        StringView typeToken = "#pragma type ";
-        size_t typeTokenLength = typeToken.length();
-        size_t pos = shaderSource.find(typeToken, 0);
-
-        while (pos != String::npos)
+        // 逐行扫描一遍，每遇到一条 #pragma type 就结束上一个阶段，阶段源码只记录切片不复制
+        const StringView source = *result.Source;
+        ShaderStage stage = ShaderStage::None;
+        size_t stageStart {0};
+        for (size_t lineStart {0}; lineStart < source.size();)
         {
-            // 提取 Shader 类型
-            size_t typeStart = pos + typeTokenLength;
-            size_t typeEnd = shaderSource.find_first_of("\r\n", typeStart);
-            if (typeEnd == String::npos) {
-                result.ErrorMessage = "Invalid #pragma type directive!";
-                return result;
+            const size_t newline = source.find('\n', lineStart);
+            const size_t lineEnd = newline == StringView::npos ? source.size() : newline;
+            const size_t nextLine = newline == StringView::npos ? source.size() : newline + 1;
+
+            StringView type;
+            if (!ParseTypeDirective(source.substr(lineStart, lineEnd - lineStart), type))
+            {
+                lineStart = nextLine;
+                continue;
             }
-            // 获取类型字符串
-            String typeStr = shaderSource.substr(typeStart, typeEnd - typeStart);
-            PString::StringTrim(typeStr); // 去除前后空白字符
+
+            if (stage != ShaderStage::None)
+                result.Sources[stage] = source.substr(stageStart, lineStart - stageStart);
+
             // 将类型字符串转换为 ShaderStage
-            ShaderStage stage = Utils::Shader::ShaderTypeFromString(typeStr);
-            if (stage == ShaderStage::None) {
-                result.ErrorMessage = "Unknown shader stage: " + typeStr;
+            stage = Utils::Shader::ShaderTypeFromString(type);
+            if (stage == ShaderStage::None)
+            {
+                result.ErrorMessage = "Unknown shader stage: " + String(type);
                 return result;
             }
-            // 提取当前阶段的代码
-            size_t codeStart = typeEnd + 1; // 跳过换行符
-            size_t codeEnd = shaderSource.find(typeToken, codeStart);
-            if (codeEnd == String::npos) {
-                codeEnd = shaderSource.length(); // 如果是最后一个阶段，代码到文件末尾
+            if (result.Sources.contains(stage))
+            {
+                result.ErrorMessage = "Duplicate shader stage: " + String(type);
+                return result;
             }
-            // 保存当前阶段的代码
-            sources[stage] = shaderSource.substr(codeStart, codeEnd - codeStart);;
-            // 更新搜索位置
-            pos = shaderSource.find(typeToken, codeEnd);
-
+            stageStart = nextLine;
+            lineStart = nextLine;
         }
+        if (stage != ShaderStage::None)
+            result.Sources[stage] = source.substr(stageStart);
 
-        if (sources.empty()) {
+        if (result.Sources.empty()) {
             result.ErrorMessage = "No valid shader stages found";
             return result;
         }
 
-        result.Sources = sources;
         result.Success = true;
         return result;
-
     }
+
     String ShaderCompiler::ReadFile(const File::Path& filePath)
     {
         Log::CatInfo("Shader","Shader Compiler Reading File Path : {0}",filePath.string());
-        String result;
-        if (std::ifstream in(filePath, std::ios::in | std::ios::binary); in)
-        {
-            in.seekg(0, std::ios::end);
-            if (const size_t size = in.tellg(); size != -1)
-            {
-                result.resize(size);
-                in.seekg(0, std::ios::beg);
-                in.read(&result[0], size);
-                in.close();
-            }
-            else
-            {
-                Log::CatError("Shader", "Could not read from file '{0}'", filePath.string());
-            }
-        }
-        else
+        String text;
+        if (!File::ReadTextFile(filePath, text))
         {
             Log::CatError("Shader","Could not read from file '{0}'", filePath.string());
+            return {};
         }
-        return result;
+        return text;
     }
 }
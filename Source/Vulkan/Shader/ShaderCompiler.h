@@ -1,18 +1,20 @@
 ﻿#pragma once
 
 #include <shaderc/shaderc.hpp>
+#include <spirv-tools/optimizer.hpp>
 
+#include "ShaderCache.h"
+#include "ShaderDependency.h"
 #include "ShaderUtils.h"
+#include "ShaderVariant.h"
 #include "Core/BaseType.h"
 #include "Core/FileSystem.h"
+#include "Core/ThreadPool.h"
 
 
 // [Shader Asset] -> [Preprocessor] -> [IR Generator] ->[API Compiler]->[Bytecode]->[Cache System]->[Runtime Loader]
 
 
-using SPIRVBinary = Vector<u32>;
-using SPIRVBinaryDatas = Map<ShaderStage, SPIRVBinary>;
-
 namespace ShaderAPIFlags
 {
     enum ShaderAPIFlags : u8
@@ -47,6 +49,13 @@ struct CacheCompileResult
     String ErrorMessage;
 };
 
+// 编译请求
+struct ShaderCompileRequest
+{
+    File::Path FilePath;                  // Shader文件路径
+    ShaderVariantKey Variant;             // 变体宏定义
+};
+
 // SPIRV编译结果
 struct SPIRVCompilerResult
 {
@@ -54,12 +63,16 @@ struct SPIRVCompilerResult
     String ErrorMessage;                  // 错误信息
     bool Success {false};                 // 是否成功
 };
-// Shader预处理结果
+// Shader预处理结果，各阶段源码是读入源码的切片，复制结果时共享同一份源码
 struct ShaderPreprocessResult
 {
     String Name;                          // Shader名称
+    File::Path FilePath;                  // Shader文件路径
     ShaderSourceLang SourceLang;   // Shader语言
-    Map<ShaderStage, String> Sources;     // Shader源码
+    SharedPtr<const String> Source;       // 读入的源码，源文件可能随时被编辑，不使用映射
+    Map<ShaderStage, StringView> Sources; // 各阶段源码，指向Source
+    ShaderVariantKey Variant;             // 编译时附加的宏定义
+    ShaderCompileProfile Profile {ShaderCompileProfile::Debug}; // 编译配置
     bool Success = false;                 // 是否成功
     String ErrorMessage;                  // 错误信息
 };
@@ -98,6 +111,43 @@ namespace Utils::Shader
 
 }
 
+/**
+ * @brief 单个编译配置下的编译目标
+ * @details 编译选项和SPIRV-Tools优化器都按配置预先构造，编译时直接取用
+ */
+struct ShaderCompileTarget
+{
+    shaderc::CompileOptions Options;            ///< 编译选项
+    UniquePtr<spvtools::Optimizer> Optimizer;   ///< 编译后执行的优化和剥离步骤，不需要时为空
+    ShaderIncluder* Includer {nullptr};         ///< 包含文件解析器，由Options持有，只有Vulkan目标设置
+};
+
+/**
+ * @brief Shader编译上下文
+ * @details
+ * 持有编译器和各目标环境、各编译配置的编译选项，构造开销较大，应在多次编译间复用 \n
+ * 编译器不能跨线程共享，每个线程通过ShaderCompiler::GetCompileContext获取自己的上下文
+ */
+struct ShaderCompileContext
+{
+    static constexpr size_t ProfileCount = static_cast<size_t>(ShaderCompileProfile::Count);
+
+    ShaderCompileContext();
+    ShaderCompileContext(const ShaderCompileContext&) = delete;
+    ShaderCompileContext& operator=(const ShaderCompileContext&) = delete;
+
+    // 获取Vulkan编译目标
+    ShaderCompileTarget& GetVulkanTarget(const ShaderCompileProfile profile) { return VulkanTargets[static_cast<size_t>(profile)]; }
+
+    // 获取OpenGL编译目标
+    ShaderCompileTarget& GetOpenGLTarget(const ShaderCompileProfile profile) { return OpenGLTargets[static_cast<size_t>(profile)]; }
+
+    shaderc::Compiler Compiler;                                 ///< 编译器
+    Array<ShaderCompileTarget, ProfileCount> VulkanTargets;     ///< Vulkan目标，按编译配置索引
+    Array<ShaderCompileTarget, ProfileCount> OpenGLTargets;     ///< OpenGL目标，按编译配置索引
+    String OptimizerMessage;                                    ///< 优化器最近一次输出的错误信息
+};
+
 /**
  * @brief Shader编译器
  */
@@ -107,7 +157,17 @@ public:
     // 预处理文件
     static ShaderPreprocessResult PreprocessShaderFile(const File::Path& filePath);
 
-    static CacheCompileResult CacheCompile(const File::Path& filePath, u8 flags = ShaderAPIFlags::OpenGL);
+    // 编译文件，variant中的宏会作为预定义宏传给编译器，不同变体拥有独立的缓存条目
+    static CacheCompileResult CacheCompile(const File::Path& filePath, u8 flags = ShaderAPIFlags::OpenGL, const ShaderVariantKey& variant = {});
+
+    // 与CacheCompile相同，但失败时不断言，错误信息放在结果中，用于热重载和变体等可能遇到错误输入的路径
+    static CacheCompileResult TryCacheCompile(const File::Path& filePath, u8 flags = ShaderAPIFlags::OpenGL, const ShaderVariantKey& variant = {});
+
+    // 批量编译，文件和阶段分散到线程池并行编译，结果与输入顺序一致
+    static Vector<CacheCompileResult> CompileAll(Span<const File::Path> filePaths, u8 flags = ShaderAPIFlags::OpenGL);
+
+    // 批量编译变体，与按路径编译走同一条路径
+    static Vector<CacheCompileResult> CompileAll(Span<const ShaderCompileRequest> requests, u8 flags = ShaderAPIFlags::OpenGL);
 
     // 编译Vulkan SPIRV
     static SPIRVBinaryDatas CompileVulkanBinaries(const ShaderPreprocessResult& processResult);
@@ -115,5 +175,34 @@ public:
     // 编译OpenGL SPIRV，将Vulkan SPIRV转换为OpenGL SPIRV以消除Vulkan标准的GLSL差异
     static SPIRVBinaryDatas CompileOpenGLBinaries(const ShaderPreprocessResult& processResult);
 
+    // 读取整个文件
     static String ReadFile(const File::Path& filePath);
+
+    // 设置编译配置，之后预处理的shader使用该配置，不同配置拥有独立的缓存条目
+    static void SetCompileProfile(ShaderCompileProfile profile);
+
+    // 获取编译配置，调试构建默认为Debug，其余为Release
+    static ShaderCompileProfile GetCompileProfile();
+
+    // 获取当前线程的编译上下文
+    static ShaderCompileContext& GetCompileContext();
+
+    // 编译线程池
+    static ThreadPool& GetThreadPool();
+
+private:
+    // 编译单个Vulkan阶段，优先读取缓存
+    static bool CompileVulkanStage(const ShaderPreprocessResult& processResult, ShaderStage stage,
+        ShaderCompileContext& context, SPIRVBinary& outBinary, String& outError);
+
+    // 编译单个OpenGL阶段，优先读取缓存，未命中时才编译Vulkan阶段
+    static bool CompileOpenGLStage(const ShaderPreprocessResult& processResult, ShaderStage stage,
+        ShaderCompileContext& context, SPIRVBinary& outBinary, String& outError);
+
+    // 对编译产物执行编译配置附加的优化和剥离步骤
+    static bool RunOptimizer(ShaderCompileTarget& target, ShaderCompileContext& context, SPIRVBinary& binary, String& outError);
+
+    // 写入缓存条目，成功后删除同一源文件、阶段、目标和变体的旧条目
+    static void StoreAndPrune(const ShaderPreprocessResult& processResult, const ShaderCacheKeyDesc& keyDesc, u64 cacheKey,
+        Str extension, const SPIRVBinary& binary);
 };
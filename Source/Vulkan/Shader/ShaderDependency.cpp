@@ -0,0 +1,287 @@
+﻿#include "ShaderDependency.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "ShaderCompiler.h"
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+shaderc_include_result* ShaderIncluder::GetInclude(const char* requestedSource, const shaderc_include_type type,
+    const char* requestingSource, const size_t includeDepth)
+{
+    auto* data = new IncludeData;
+    const File::Path resolved = includeDepth > MaxIncludeDepth ? File::Path{} : Resolve(requestedSource, type, requestingSource);
+    if (resolved.empty())
+    {
+        data->Content = includeDepth > MaxIncludeDepth
+            ? "Include depth exceeded while including '" + String(requestedSource) + "'"
+            : "Could not find include file '" + String(requestedSource) + "'";
+    }
+    else
+    {
+        data->SourceName = resolved.generic_string();
+        // 包含文件同样可能在编译期间被编辑，读入副本而不是映射
+        if (!File::ReadTextFile(resolved, data->Content))
+            data->Content = "Could not read include file '" + data->SourceName + "'";
+        m_Includes.insert(resolved);
+    }
+
+    data->Result.source_name        = data->SourceName.c_str();
+    data->Result.source_name_length = data->SourceName.size();
+    data->Result.content            = data->Content.data();
+    data->Result.content_length     = data->Content.size();
+    data->Result.user_data          = data;
+    return &data->Result;
+}
+
+void ShaderIncluder::ReleaseInclude(shaderc_include_result* data)
+{
+    delete static_cast<IncludeData*>(data->user_data);
+}
+
+File::Path ShaderIncluder::Resolve(const File::Path& requested, const shaderc_include_type type, const File::Path& requesting)
+{
+    std::error_code error;
+    if (type == shaderc_include_type_relative)
+    {
+        if (File::Path candidate = requesting.parent_path() / requested; std::filesystem::is_regular_file(candidate, error))
+            return candidate.lexically_normal();
+    }
+
+    if (File::Path candidate = CastToProjectPath(Utils::Shader::GetShaderIncludeDir()) / requested; std::filesystem::is_regular_file(candidate, error))
+        return candidate.lexically_normal();
+
+    return {};
+}
+
+ShaderDependencyGraph& ShaderDependencyGraph::Get()
+{
+    static ShaderDependencyGraph graph;
+    static std::once_flag loadFlag;
+    std::call_once(loadFlag, [] { graph.Load(ShaderCache::GetDependencyGraphPath()); });
+    return graph;
+}
+
+u64 ShaderDependencyGraph::GetDependencyHash(const String& unitName)
+{
+    std::lock_guard lock(m_Mutex);
+    const auto it = m_Dependencies.find(unitName);
+    if (it == m_Dependencies.end())
+        return 0;
+
+    u64 hash = Hash::Hash64(unitName);
+    for (const String& include : it->second)
+    {
+        hash = Hash::Combine64(hash, Hash::Hash64(include));
+        hash = Hash::Combine64(hash, QueryFileState(include).Hash);
+    }
+    return hash;
+}
+
+bool ShaderDependencyGraph::DependsOn(const String& unitName, const File::Path& filePath)
+{
+    const String path = filePath.lexically_normal().generic_string();
+
+    std::lock_guard lock(m_Mutex);
+    const auto it = m_Dependencies.find(unitName);
+    return it != m_Dependencies.end() && std::ranges::find(it->second, path) != it->second.end();
+}
+
+namespace
+{
+    std::filesystem::file_time_type GetWriteTime(const String& path)
+    {
+        std::error_code error;
+        const auto writeTime = std::filesystem::last_write_time(path, error);
+        return error ? std::filesystem::file_time_type::min() : writeTime;
+    }
+}
+
+ShaderDependencyGraph::WriteTimes ShaderDependencyGraph::SnapshotWriteTimes(const File::Path& filePath)
+{
+    const String path = filePath.lexically_normal().generic_string();
+    Vector<String> files {path};
+    {
+        // 编译单元名称以"<路径>:"开头，各阶段和变体的单元在有序表中相邻
+        const String prefix = path + ":";
+        std::lock_guard lock(m_Mutex);
+        for (auto it = m_Dependencies.lower_bound(prefix); it != m_Dependencies.end() && it->first.starts_with(prefix); ++it)
+        {
+            files.insert(files.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    WriteTimes snapshot;
+    snapshot.reserve(files.size());
+    for (String& file : files)
+    {
+        const auto writeTime = GetWriteTime(file);
+        snapshot.emplace_back(std::move(file), writeTime);
+    }
+    return snapshot;
+}
+
+bool ShaderDependencyGraph::HasChanged(const WriteTimes& snapshot)
+{
+    return std::ranges::any_of(snapshot, [](const auto& entry) { return GetWriteTime(entry.first) != entry.second; });
+}
+
+void ShaderDependencyGraph::SetDependencies(const String& unitName, const Set<File::Path>& includes)
+{
+    Vector<String> dependencies;
+    dependencies.reserve(includes.size());
+    for (const File::Path& include : includes)
+    {
+        dependencies.push_back(include.generic_string());
+    }
+
+    std::lock_guard lock(m_Mutex);
+    for (const String& include : dependencies)
+    {
+        // 刚被编译器读取过的文件强制刷新状态
+        m_FileStates.erase(include);
+        QueryFileState(include);
+    }
+    m_Dependencies[unitName] = std::move(dependencies);
+    m_Dirty = true;
+}
+
+const ShaderDependencyGraph::FileState& ShaderDependencyGraph::QueryFileState(const String& path)
+{
+    std::error_code error;
+    const auto writeTime = std::filesystem::last_write_time(path, error);
+    const i64 modifyTime = error ? 0 : static_cast<i64>(writeTime.time_since_epoch().count());
+
+    FileState& state = m_FileStates[path];
+    if (state.ModifyTime == modifyTime && modifyTime != 0)
+        return state;
+
+    // 修改时间变化，重新计算内容哈希；文件不存在时哈希为0，下次编译会报告找不到包含文件
+    String content;
+    if (!error)
+        File::ReadTextFile(path, content);
+    state.ModifyTime = modifyTime;
+    state.Hash       = error ? 0 : Hash::Hash64(StringView(content));
+    m_Dirty = true;
+    return state;
+}
+
+String ShaderDependencyGraph::MakeUnitName(const File::Path& filePath, const ShaderStage stage, const u64 variantHash)
+{
+    String unitName = filePath.generic_string() + ":" + Utils::Shader::ShaderStageToString(stage);
+    if (variantHash != 0)
+        unitName += ":" + Hash::ToHexString(variantHash);
+    return unitName;
+}
+
+/**
+ * 依赖图文件格式(文本):
+ * PLDG <版本>
+ * F <修改时间> <内容哈希> <路径>
+ * U <包含数量> <编译单元>
+ * D <路径>
+ */
+bool ShaderDependencyGraph::Load(const File::Path& path)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+        return false;
+
+    String magic;
+    u32 version {0};
+    if (!(in >> magic >> version) || magic != "PLDG" || version != Version)
+    {
+        Log::CatWarn("Shader", "Shader dependency graph '{0}' is outdated, ignoring it", path.string());
+        return false;
+    }
+
+    std::lock_guard lock(m_Mutex);
+    m_Dependencies.clear();
+    m_FileStates.clear();
+
+    Vector<String>* currentUnit {nullptr};
+    String tag;
+    while (in >> tag)
+    {
+        String name;
+        if (tag == "F")
+        {
+            FileState state;
+            in >> state.ModifyTime >> std::hex >> state.Hash >> std::dec;
+            in.ignore(1);
+            std::getline(in, name);
+            m_FileStates[name] = state;
+        }
+        else if (tag == "U")
+        {
+            size_t count {0};
+            in >> count;
+            in.ignore(1);
+            std::getline(in, name);
+            currentUnit = &m_Dependencies[name];
+            currentUnit->reserve(count);
+        }
+        else if (tag == "D" && currentUnit != nullptr)
+        {
+            in.ignore(1);
+            std::getline(in, name);
+            currentUnit->push_back(std::move(name));
+        }
+        else
+        {
+            Log::CatWarn("Shader", "Shader dependency graph '{0}' is corrupted, ignoring it", path.string());
+            m_Dependencies.clear();
+            m_FileStates.clear();
+            return false;
+        }
+    }
+    m_Dirty = false;
+    return true;
+}
+
+bool ShaderDependencyGraph::SaveIfDirty(const File::Path& path)
+{
+    std::lock_guard lock(m_Mutex);
+    if (!m_Dirty)
+        return true;
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    File::Path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::trunc);
+        if (!out.is_open())
+        {
+            Log::CatError("Shader", "Could not write shader dependency graph '{0}'", tempPath.string());
+            return false;
+        }
+
+        out << "PLDG " << Version << '\n';
+        for (const auto& [file, state] : m_FileStates)
+        {
+            out << "F " << state.ModifyTime << ' ' << std::hex << state.Hash << std::dec << ' ' << file << '\n';
+        }
+        for (const auto& [unit, dependencies] : m_Dependencies)
+        {
+            out << "U " << dependencies.size() << ' ' << unit << '\n';
+            for (const String& dependency : dependencies)
+            {
+                out << "D " << dependency << '\n';
+            }
+        }
+        if (!out.flush())
+            return false;
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        Log::CatError("Shader", "Could not replace shader dependency graph '{0}': {1}", path.string(), error.message());
+        return false;
+    }
+    m_Dirty = false;
+    return true;
+}
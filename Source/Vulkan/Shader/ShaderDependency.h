@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <mutex>
+
+#include <shaderc/shaderc.hpp>
+
+#include "ShaderUtils.h"
+#include "Core/BaseType.h"
+#include "Core/FileSystem.h"
+
+/**
+ * @class ShaderIncluder
+ * @brief Shader包含文件解析器
+ * @details
+ * "file" 先相对请求文件所在目录查找，再查找包含目录；<file> 只查找包含目录 \n
+ * 捕获期间解析到的所有文件(包括间接包含)都会被记录，用于构建依赖图 \n
+ * 每个编译上下文持有一个实例，不跨线程共享
+ */
+class ShaderIncluder final : public shaderc::CompileOptions::IncluderInterface
+{
+public:
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type,
+        const char* requestingSource, size_t includeDepth) override;
+    void ReleaseInclude(shaderc_include_result* data) override;
+
+    // 开始记录包含文件
+    void BeginCapture() { m_Includes.clear(); }
+
+    // 结束记录，返回期间包含的所有文件
+    Set<File::Path> EndCapture() { return std::move(m_Includes); }
+
+private:
+    // 解析包含路径，找不到时返回空路径
+    static File::Path Resolve(const File::Path& requested, shaderc_include_type type, const File::Path& requesting);
+
+private:
+    struct IncludeData
+    {
+        String SourceName;                  ///< 解析后的路径，失败时为空
+        String Content;                     ///< 包含文件的内容，失败时为错误信息
+        shaderc_include_result Result {};   ///< 返回给shaderc的结果
+    };
+
+    static constexpr size_t MaxIncludeDepth = 32;
+
+    Set<File::Path> m_Includes;             ///< 捕获期间包含的文件
+};
+
+/**
+ * @class ShaderDependencyGraph
+ * @brief Shader包含依赖图
+ * @details
+ * 记录每个编译单元(文件+阶段)的传递包含集合，并与缓存一起持久化 \n
+ * 依赖哈希参与缓存键计算，包含文件修改后对应的缓存自动失效 \n
+ * 文件内容哈希按修改时间缓存，修改时间未变的文件不会被重新读取 \n
+ * 所有接口线程安全
+ */
+class ShaderDependencyGraph
+{
+public:
+    static constexpr u32 Version = 1;
+
+    /** 获取单例，首次访问时从缓存目录加载 */
+    static ShaderDependencyGraph& Get();
+
+    // 计算编译单元当前的依赖哈希，没有记录的单元返回0
+    u64 GetDependencyHash(const String& unitName);
+
+    // 编译单元是否包含了指定文件
+    bool DependsOn(const String& unitName, const File::Path& filePath);
+
+    // 文件和它所有编译单元的包含文件的修改时间，文件不存在时为file_time_type::min()
+    using WriteTimes = Vector<std::pair<String, std::filesystem::file_time_type>>;
+
+    // 记录文件本身和它任一编译单元的包含文件当前的修改时间
+    WriteTimes SnapshotWriteTimes(const File::Path& filePath);
+
+    // 快照中是否有文件的修改时间已经变化，只比较前后两次读取的值，不受时钟偏差和未来时间戳影响
+    static bool HasChanged(const WriteTimes& snapshot);
+
+    // 更新编译单元的包含集合
+    void SetDependencies(const String& unitName, const Set<File::Path>& includes);
+
+    // 读取依赖图
+    bool Load(const File::Path& path);
+
+    // 有修改时写回依赖图
+    bool SaveIfDirty(const File::Path& path);
+
+    // 生成编译单元名称，不同变体可能包含不同的文件，因此各自是独立的编译单元
+    static String MakeUnitName(const File::Path& filePath, ShaderStage stage, u64 variantHash = 0);
+
+private:
+    struct FileState
+    {
+        i64 ModifyTime {0};     ///< 修改时间
+        u64 Hash {0};           ///< 内容哈希
+    };
+
+    // 查询文件状态，修改时间变化时重新计算哈希，调用前需持有锁
+    const FileState& QueryFileState(const String& path);
+
+private:
+    Map<String, Vector<String>> m_Dependencies;     ///< 编译单元 -> 传递包含的文件
+    UMap<String, FileState> m_FileStates;           ///< 文件 -> 状态
+    std::mutex m_Mutex;                             ///< 保护以上数据
+    bool m_Dirty {false};                           ///< 是否有未保存的修改
+};
@@ -0,0 +1,403 @@
+﻿#include "ShaderReflection.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <spirv_cross/spirv_cross.hpp>
+
+#include "ShaderCache.h"
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+namespace
+{
+    // 反射缓存条目后缀
+    constexpr Str ReflectionCacheExtension = ".reflect";
+
+    // 缓存数据写入器，数据按字节追加，结束时补齐到4字节
+    class ReflectionWriter
+    {
+    public:
+        void Write(const u32 value) { Append(&value, sizeof(value)); }
+        void Write(const String& value)
+        {
+            Write(static_cast<u32>(value.size()));
+            Append(value.data(), value.size());
+        }
+
+        SPIRVBinary Finish() const
+        {
+            SPIRVBinary words((m_Bytes.size() + sizeof(u32) - 1) / sizeof(u32), 0);
+            std::memcpy(words.data(), m_Bytes.data(), m_Bytes.size());
+            return words;
+        }
+
+    private:
+        void Append(const void* data, const size_t size)
+        {
+            const auto* bytes = static_cast<const u8*>(data);
+            m_Bytes.insert(m_Bytes.end(), bytes, bytes + size);
+        }
+
+        Vector<u8> m_Bytes;
+    };
+
+    // 缓存数据读取器，越界时返回false
+    class ReflectionReader
+    {
+    public:
+        explicit ReflectionReader(const Span<const u32> payload)
+            : m_Data(reinterpret_cast<const u8*>(payload.data())), m_Size(payload.size_bytes()) {}
+
+        bool Read(u32& value) { return Extract(&value, sizeof(value)); }
+        bool Read(String& value)
+        {
+            u32 size {0};
+            if (!Read(size) || size > m_Size - m_Offset)
+                return false;
+            value.assign(reinterpret_cast<const char*>(m_Data + m_Offset), size);
+            m_Offset += size;
+            return true;
+        }
+        template<typename T> requires std::is_enum_v<T>
+        bool Read(T& value)
+        {
+            u32 raw {0};
+            if (!Read(raw))
+                return false;
+            value = static_cast<T>(raw);
+            return true;
+        }
+
+    private:
+        bool Extract(void* data, const size_t size)
+        {
+            if (size > m_Size - m_Offset)
+                return false;
+            std::memcpy(data, m_Data + m_Offset, size);
+            m_Offset += size;
+            return true;
+        }
+
+        const u8* m_Data {nullptr};
+        size_t m_Size {0};
+        size_t m_Offset {0};
+    };
+
+    // 数组元素总数，运行时大小的数组返回0
+    u32 GetArrayCount(const spirv_cross::SPIRType& type)
+    {
+        u32 count {1};
+        for (size_t i {0}; i < type.array.size(); ++i)
+        {
+            if (!type.array_size_literal[i])
+                continue;
+            if (type.array[i] == 0)
+                return 0;
+            count *= type.array[i];
+        }
+        return count;
+    }
+
+    // 顶点输入类型对应的格式，不支持的类型返回VK_FORMAT_UNDEFINED
+    VkFormat GetVertexFormat(const spirv_cross::SPIRType& type)
+    {
+        constexpr VkFormat floatFormats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+        constexpr VkFormat intFormats[]   = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+        constexpr VkFormat uintFormats[]  = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+        if (type.vecsize < 1 || type.vecsize > 4 || type.columns != 1)
+            return VK_FORMAT_UNDEFINED;
+
+        switch (type.basetype)
+        {
+        case spirv_cross::SPIRType::Float:  return floatFormats[type.vecsize - 1];
+        case spirv_cross::SPIRType::Int:    return intFormats[type.vecsize - 1];
+        case spirv_cross::SPIRType::UInt:   return uintFormats[type.vecsize - 1];
+        default:                            return VK_FORMAT_UNDEFINED;
+        }
+    }
+}
+
+ShaderReflectionData ShaderReflection::ReflectAll(const String& shaderName, const SPIRVBinaryViews& binaries)
+{
+    const u64 cacheKey = ComputeKey(binaries);
+    const File::Path cachedPath = ShaderCache::GetEntryPath(shaderName, cacheKey, ReflectionCacheExtension);
+
+    ShaderReflectionData result;
+    if (SPIRVBinary payload; ShaderCache::Load(cachedPath, cacheKey, payload))
+    {
+        if (Deserialize(payload, result))
+            return result;
+        result = {};
+    }
+
+    try
+    {
+        for (const auto& [stage, binary] : binaries)
+        {
+            String errorMessage;
+            if (!Merge(result, Reflect(stage, binary), errorMessage))
+            {
+                // 冲突的布局不能缓存，也不能替换现有shader，交由调用方处理
+                throw std::runtime_error("Shader '" + shaderName + "' reflection error: " + errorMessage);
+            }
+        }
+    }
+    catch (const spirv_cross::CompilerError& error)
+    {
+        Log::CatError("Shader", "Shader '{0}' reflection failed: {1}", shaderName, error.what());
+        return {};
+    }
+
+    ShaderCache::Store(cachedPath, cacheKey, Serialize(result));
+    return result;
+}
+
+ShaderReflectionData ShaderReflection::Reflect(const ShaderStage stage, const Span<const u32> binary)
+{
+    const spirv_cross::Compiler compiler(binary.data(), binary.size());
+    const spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+    const VkShaderStageFlags stageFlags = Utils::Shader::ShaderStageToVulkan(stage);
+
+    ShaderReflectionData result;
+    auto addBindings = [&](const spirv_cross::SmallVector<spirv_cross::Resource>& list, const VkDescriptorType descriptorType, const bool isBuffer)
+    {
+        for (const spirv_cross::Resource& resource : list)
+        {
+            ShaderDescriptorBinding binding;
+            binding.Name       = resource.name;
+            binding.Set        = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+            binding.Binding    = compiler.get_decoration(resource.id, spv::DecorationBinding);
+            binding.Count      = GetArrayCount(compiler.get_type(resource.type_id));
+            binding.Size       = isBuffer ? static_cast<u32>(compiler.get_declared_struct_size(compiler.get_type(resource.base_type_id))) : 0;
+            binding.Type       = descriptorType;
+            binding.StageFlags = stageFlags;
+            result.Bindings.push_back(std::move(binding));
+        }
+    };
+    addBindings(resources.uniform_buffers,         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             true);
+    addBindings(resources.storage_buffers,         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             true);
+    addBindings(resources.sampled_images,          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,     false);
+    addBindings(resources.separate_images,         VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,              false);
+    addBindings(resources.separate_samplers,       VK_DESCRIPTOR_TYPE_SAMPLER,                    false);
+    addBindings(resources.storage_images,          VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              false);
+    addBindings(resources.subpass_inputs,          VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,           false);
+    addBindings(resources.acceleration_structures, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, false);
+
+    // 推送常量只记录实际用到的范围
+    for (const spirv_cross::Resource& resource : resources.push_constant_buffers)
+    {
+        size_t begin {std::numeric_limits<size_t>::max()};
+        size_t end {0};
+        for (const spirv_cross::BufferRange& range : compiler.get_active_buffer_ranges(resource.id))
+        {
+            begin = std::min(begin, range.offset);
+            end   = std::max(end, range.offset + range.range);
+        }
+        if (begin >= end)
+        {
+            begin = 0;
+            end   = compiler.get_declared_struct_size(compiler.get_type(resource.base_type_id));
+        }
+        result.PushConstants.push_back({stageFlags, static_cast<u32>(begin), static_cast<u32>(end - begin)});
+    }
+
+    if (stage == ShaderStage::Vertex)
+    {
+        for (const spirv_cross::Resource& resource : resources.stage_inputs)
+        {
+            ShaderVertexInput input;
+            input.Name     = resource.name;
+            input.Location = compiler.get_decoration(resource.id, spv::DecorationLocation);
+            input.Format   = GetVertexFormat(compiler.get_type(resource.type_id));
+            result.VertexInputs.push_back(std::move(input));
+        }
+    }
+
+    for (const spirv_cross::SpecializationConstant& constant : compiler.get_specialization_constants())
+    {
+        result.SpecializationConstants.push_back({compiler.get_name(constant.id), constant.constant_id, stageFlags});
+    }
+    return result;
+}
+
+bool ShaderReflection::Merge(ShaderReflectionData& target, const ShaderReflectionData& source, String& outError)
+{
+    bool success {true};
+    for (const ShaderDescriptorBinding& binding : source.Bindings)
+    {
+        const auto it = std::ranges::find_if(target.Bindings, [&](const ShaderDescriptorBinding& other)
+        {
+            return other.Set == binding.Set && other.Binding == binding.Binding;
+        });
+        if (it == target.Bindings.end())
+        {
+            target.Bindings.push_back(binding);
+            continue;
+        }
+        if (it->Type != binding.Type)
+        {
+            outError += "Descriptor set " + std::to_string(binding.Set) + " binding " + std::to_string(binding.Binding)
+                + " has different types in different stages ('" + it->Name + "', '" + binding.Name + "')\n";
+            success = false;
+            continue;
+        }
+        // 任一阶段声明为运行时大小的数组时保持为0，由调用者指定数量；固定大小不一致视为冲突
+        if (it->Count != binding.Count && it->Count != 0 && binding.Count != 0)
+        {
+            outError += "Descriptor set " + std::to_string(binding.Set) + " binding " + std::to_string(binding.Binding)
+                + " has different array sizes in different stages ('" + it->Name + "' " + std::to_string(it->Count)
+                + ", '" + binding.Name + "' " + std::to_string(binding.Count) + ")\n";
+            success = false;
+            continue;
+        }
+        it->StageFlags |= binding.StageFlags;
+        it->Count = std::min(it->Count, binding.Count);
+        it->Size  = std::max(it->Size, binding.Size);
+    }
+
+    // 范围完全相同的推送常量合并阶段，否则各阶段使用独立的范围
+    for (const VkPushConstantRange& range : source.PushConstants)
+    {
+        const auto it = std::ranges::find_if(target.PushConstants, [&](const VkPushConstantRange& other)
+        {
+            return other.offset == range.offset && other.size == range.size;
+        });
+        if (it != target.PushConstants.end())
+            it->stageFlags |= range.stageFlags;
+        else
+            target.PushConstants.push_back(range);
+    }
+
+    target.VertexInputs.insert(target.VertexInputs.end(), source.VertexInputs.begin(), source.VertexInputs.end());
+
+    for (const ShaderSpecializationConstant& constant : source.SpecializationConstants)
+    {
+        const auto it = std::ranges::find(target.SpecializationConstants, constant.ConstantId, &ShaderSpecializationConstant::ConstantId);
+        if (it != target.SpecializationConstants.end())
+            it->StageFlags |= constant.StageFlags;
+        else
+            target.SpecializationConstants.push_back(constant);
+    }
+
+    std::ranges::sort(target.Bindings, {}, [](const ShaderDescriptorBinding& binding) { return std::pair(binding.Set, binding.Binding); });
+    std::ranges::sort(target.VertexInputs, {}, &ShaderVertexInput::Location);
+    std::ranges::sort(target.SpecializationConstants, {}, &ShaderSpecializationConstant::ConstantId);
+    return success;
+}
+
+Map<u32, Vector<VkDescriptorSetLayoutBinding>> ShaderReflection::MakeDescriptorSetLayoutBindings(const ShaderReflectionData& data)
+{
+    // 运行时大小的数组Count为0，调用者需要自行指定数量
+    Map<u32, Vector<VkDescriptorSetLayoutBinding>> result;
+    for (const ShaderDescriptorBinding& binding : data.Bindings)
+    {
+        result[binding.Set].push_back({binding.Binding, binding.Type, binding.Count, binding.StageFlags, nullptr});
+    }
+    return result;
+}
+
+u64 ShaderReflection::ComputeKey(const SPIRVBinaryViews& binaries)
+{
+    u64 key = Hash::Hash64(StringView("ShaderReflection"));
+    key = Hash::Combine64(key, Version);
+    for (const auto& [stage, binary] : binaries)
+    {
+        key = Hash::Combine64(key, static_cast<u64>(stage));
+        key = Hash::Combine64(key, Hash::Hash64(binary.data(), binary.size() * sizeof(u32)));
+    }
+    return key;
+}
+
+SPIRVBinary ShaderReflection::Serialize(const ShaderReflectionData& data)
+{
+    ReflectionWriter writer;
+    writer.Write(Version);
+
+    writer.Write(static_cast<u32>(data.Bindings.size()));
+    for (const ShaderDescriptorBinding& binding : data.Bindings)
+    {
+        writer.Write(binding.Name);
+        writer.Write(binding.Set);
+        writer.Write(binding.Binding);
+        writer.Write(binding.Count);
+        writer.Write(binding.Size);
+        writer.Write(static_cast<u32>(binding.Type));
+        writer.Write(binding.StageFlags);
+    }
+
+    writer.Write(static_cast<u32>(data.PushConstants.size()));
+    for (const VkPushConstantRange& range : data.PushConstants)
+    {
+        writer.Write(range.stageFlags);
+        writer.Write(range.offset);
+        writer.Write(range.size);
+    }
+
+    writer.Write(static_cast<u32>(data.VertexInputs.size()));
+    for (const ShaderVertexInput& input : data.VertexInputs)
+    {
+        writer.Write(input.Name);
+        writer.Write(input.Location);
+        writer.Write(static_cast<u32>(input.Format));
+    }
+
+    writer.Write(static_cast<u32>(data.SpecializationConstants.size()));
+    for (const ShaderSpecializationConstant& constant : data.SpecializationConstants)
+    {
+        writer.Write(constant.Name);
+        writer.Write(constant.ConstantId);
+        writer.Write(constant.StageFlags);
+    }
+    return writer.Finish();
+}
+
+bool ShaderReflection::Deserialize(const Span<const u32> payload, ShaderReflectionData& outData)
+{
+    ReflectionReader reader(payload);
+    u32 version {0};
+    if (!reader.Read(version) || version != Version)
+        return false;
+
+    // 每个元素至少占一个字，数量超过剩余数据说明缓存已损坏
+    u32 count {0};
+    auto readCount = [&] { return reader.Read(count) && count <= payload.size(); };
+    if (!readCount())
+        return false;
+    outData.Bindings.resize(count);
+    for (ShaderDescriptorBinding& binding : outData.Bindings)
+    {
+        if (!reader.Read(binding.Name) || !reader.Read(binding.Set) || !reader.Read(binding.Binding) || !reader.Read(binding.Count)
+            || !reader.Read(binding.Size) || !reader.Read(binding.Type) || !reader.Read(binding.StageFlags))
+            return false;
+    }
+
+    if (!readCount())
+        return false;
+    outData.PushConstants.resize(count);
+    for (VkPushConstantRange& range : outData.PushConstants)
+    {
+        if (!reader.Read(range.stageFlags) || !reader.Read(range.offset) || !reader.Read(range.size))
+            return false;
+    }
+
+    if (!readCount())
+        return false;
+    outData.VertexInputs.resize(count);
+    for (ShaderVertexInput& input : outData.VertexInputs)
+    {
+        if (!reader.Read(input.Name) || !reader.Read(input.Location) || !reader.Read(input.Format))
+            return false;
+    }
+
+    if (!readCount())
+        return false;
+    outData.SpecializationConstants.resize(count);
+    for (ShaderSpecializationConstant& constant : outData.SpecializationConstants)
+    {
+        if (!reader.Read(constant.Name) || !reader.Read(constant.ConstantId) || !reader.Read(constant.StageFlags))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderUtils.h"
+#include "Core/BaseType.h"
+
+/** @brief 描述符绑定 */
+struct ShaderDescriptorBinding
+{
+    String Name;                                                ///< 变量名称
+    u32 Set {0};                                                ///< 描述符集
+    u32 Binding {0};                                            ///< 绑定点
+    u32 Count {1};                                              ///< 数组大小，0表示运行时大小的数组
+    u32 Size {0};                                               ///< 缓冲区块大小，非缓冲区为0
+    VkDescriptorType Type {VK_DESCRIPTOR_TYPE_MAX_ENUM};        ///< 描述符类型
+    VkShaderStageFlags StageFlags {0};                          ///< 使用该绑定的阶段
+};
+
+/** @brief 顶点输入 */
+struct ShaderVertexInput
+{
+    String Name;                                ///< 变量名称
+    u32 Location {0};                           ///< location
+    VkFormat Format {VK_FORMAT_UNDEFINED};      ///< 对应的顶点格式
+};
+
+/** @brief 特化常量 */
+struct ShaderSpecializationConstant
+{
+    String Name;                                ///< 变量名称
+    u32 ConstantId {0};                         ///< constant_id
+    VkShaderStageFlags StageFlags {0};          ///< 使用该常量的阶段
+};
+
+/**
+ * @brief Shader反射数据
+ * @details 所有阶段合并后的结果，描述符按(Set, Binding)排序，顶点输入按Location排序
+ */
+struct ShaderReflectionData
+{
+    Vector<ShaderDescriptorBinding> Bindings;               ///< 描述符绑定
+    Vector<VkPushConstantRange> PushConstants;              ///< 推送常量范围
+    Vector<ShaderVertexInput> VertexInputs;                 ///< 顶点输入，只来自顶点阶段
+    Vector<ShaderSpecializationConstant> SpecializationConstants; ///< 特化常量
+};
+
+/**
+ * @class ShaderReflection
+ * @brief SPIR-V反射
+ * @details
+ * 使用spirv-cross提取每个阶段的资源并合并 \n
+ * 结果以SPIR-V内容哈希为键，和SPIR-V放在同一个缓存中(<Shader名称>.<键>.reflect) \n
+ * 只要二进制不变，之后的启动直接读取缓存，不再运行spirv-cross
+ */
+class ShaderReflection
+{
+public:
+    static constexpr u32 Version = 2;
+
+    /** 反射所有阶段并合并，优先读取缓存；阶段间绑定冲突时抛出std::runtime_error，且不写入缓存 */
+    static ShaderReflectionData ReflectAll(const String& shaderName, const SPIRVBinaryViews& binaries);
+    static ShaderReflectionData ReflectAll(const String& shaderName, const SPIRVBinaryDatas& binaries) { return ReflectAll(shaderName, Utils::Shader::MakeBinaryViews(binaries)); }
+
+    // 反射单个阶段
+    static ShaderReflectionData Reflect(ShaderStage stage, Span<const u32> binary);
+
+    // 将source合并到target，同一绑定点在不同阶段类型或固定数组大小冲突时返回false，有阶段使用运行时数组时合并为运行时数组
+    static bool Merge(ShaderReflectionData& target, const ShaderReflectionData& source, String& outError);
+
+    // 按描述符集整理绑定，可直接用于创建VkDescriptorSetLayout
+    static Map<u32, Vector<VkDescriptorSetLayoutBinding>> MakeDescriptorSetLayoutBindings(const ShaderReflectionData& data);
+
+    // 计算缓存键
+    static u64 ComputeKey(const SPIRVBinaryViews& binaries);
+    static u64 ComputeKey(const SPIRVBinaryDatas& binaries) { return ComputeKey(Utils::Shader::MakeBinaryViews(binaries)); }
+
+    // 序列化为缓存数据
+    static SPIRVBinary Serialize(const ShaderReflectionData& data);
+
+    // 从缓存数据读取，格式错误时返回false
+    static bool Deserialize(Span<const u32> payload, ShaderReflectionData& outData);
+};
+
+namespace Utils::Shader
+{
+    // 转换为Vulkan阶段标记
+    static VkShaderStageFlagBits ShaderStageToVulkan(const ShaderStage stage)
+    {
+        switch (stage)
+        {
+        case ShaderStage::Vertex:           return VK_SHADER_STAGE_VERTEX_BIT;
+        case ShaderStage::Fragment:         return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case ShaderStage::Compute:          return VK_SHADER_STAGE_COMPUTE_BIT;
+        case ShaderStage::Geometry:         return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case ShaderStage::TessControl:      return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case ShaderStage::TessEvaluation:   return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        default:                            return VK_SHADER_STAGE_ALL;
+        }
+    }
+}
@@ -1,4 +1,8 @@
 ﻿#pragma once
+#ifndef PL_SHADER_NO_COMPILER
+    #include <shaderc/shaderc.hpp>
+#endif
+
 #include "VulkanUtils.h"
 #include "Core/BaseType.h"
 
@@ -14,6 +18,10 @@ enum class ShaderStage
     TessEvaluation    ///< 评估阶段
 };
 
+using SPIRVBinary = Vector<u32>;
+using SPIRVBinaryDatas = Map<ShaderStage, SPIRVBinary>;
+using SPIRVBinaryViews = Map<ShaderStage, Span<const u32>>;   ///< 不持有数据的各阶段二进制，例如指向映射的归档
+
 
 /** @brief Shader源语言 */
 enum class ShaderSourceLang
@@ -21,6 +29,18 @@ enum class ShaderSourceLang
     None = 0, Glsl, Hlsl, Spv
 };
 
+/**
+ * @brief Shader编译配置
+ * @details
+ * Debug   不优化并保留调试信息 \n
+ * Release 按性能优化，去除调试信息和反射信息 \n
+ * Size    按体积优化，去除调试信息和反射信息
+ */
+enum class ShaderCompileProfile : u8
+{
+    Debug = 0, Release, Size, Count
+};
+
 /** @brief Shader uniform类型*/
 enum class ShaderUniformType
 {
@@ -29,7 +49,16 @@ enum class ShaderUniformType
 
 namespace Utils::Shader
 {
-    static ShaderStage ShaderTypeFromString(const String& type)
+    static SPIRVBinaryViews MakeBinaryViews(const SPIRVBinaryDatas& binaries)
+    {
+        SPIRVBinaryViews views;
+        for (const auto& [stage, binary] : binaries)
+            views.emplace(stage, Span<const u32>(binary));
+        return views;
+    }
+
+    // 未知的类型返回ShaderStage::None，由调用者报告错误，类型字符串来自shader源码，不能断言
+    static ShaderStage ShaderTypeFromString(const StringView type)
     {
         if (type == "vertex")
             return ShaderStage::Vertex;
@@ -39,7 +68,10 @@ namespace Utils::Shader
             return ShaderStage::Compute;
         if (type == "geometry")
             return ShaderStage::Geometry;
-        PL_ASSERT(false, "Unknown shader type!");
+        if (type == "tess_control" || type == "hull")
+            return ShaderStage::TessControl;
+        if (type == "tess_evaluation" || type == "domain")
+            return ShaderStage::TessEvaluation;
         return ShaderStage::None;
     }
     static Str ShaderStageToString(ShaderStage stage)
@@ -77,6 +109,27 @@ namespace Utils::Shader
         default: return "Unknown";
         }
     }
+    static ShaderCompileProfile ShaderCompileProfileFromString(const String& profile)
+    {
+        if (profile == "debug")
+            return ShaderCompileProfile::Debug;
+        if (profile == "release")
+            return ShaderCompileProfile::Release;
+        if (profile == "size")
+            return ShaderCompileProfile::Size;
+        // 未知配置返回Count，由调用方报告错误
+        return ShaderCompileProfile::Count;
+    }
+    static Str ShaderCompileProfileToString(ShaderCompileProfile profile)
+    {
+        switch (profile)
+        {
+        case ShaderCompileProfile::Debug:   return "Debug";
+        case ShaderCompileProfile::Release: return "Release";
+        case ShaderCompileProfile::Size:    return "Size";
+        default: return "Unknown";
+        }
+    }
     static String FileExtensionFromShaderLang(ShaderSourceLang lang)
     {
         switch (lang)
@@ -88,19 +141,11 @@ namespace Utils::Shader
         }
     }
 
-    // 获取shader缓存目录
-    static Str GetShaderCacheDir() { return ".cache/asset/shader";}
+    // 获取shader包含目录，相对项目目录
+    static Str GetShaderIncludeDir() { return "Asset/Shader/Include";}
     // 获取shader生成目录
     static Str GetShaderGenerateDir() { return "asset/shader/generate";}
 
-    // 初始化shader缓存目录
-    static void InitShaderCacheDir()
-    {
-        if (const String cacheDir = GetShaderCacheDir(); !std::filesystem::exists(cacheDir))
-        {
-            std::filesystem::create_directories(cacheDir);
-        }
-    }
     // 初始化shader生成目录
     static void InitShaderGenerateDir()
     {
@@ -109,6 +154,7 @@ namespace Utils::Shader
             std::filesystem::create_directories(generateDir);
         }
     }
+#ifndef PL_SHADER_NO_COMPILER
     // 获取shader类型
     static shaderc_shader_kind GetShaderKind(const ShaderStage stage)
     {
@@ -123,6 +169,34 @@ namespace Utils::Shader
         default:                            return shaderc_glsl_infer_from_source;
         }
     }
+#endif
+    // 从SPIR-V的第一个OpEntryPoint读取shader阶段
+    static ShaderStage ShaderStageFromSPIRV(const Span<const u32> binary)
+    {
+        constexpr u32 headerWordCount = 5;
+        constexpr u32 opEntryPoint = 15;
+        for (size_t i {headerWordCount}; i < binary.size();)
+        {
+            const u32 wordCount = binary[i] >> 16;
+            if (wordCount == 0)
+                break;
+            if ((binary[i] & 0xFFFF) == opEntryPoint && i + 1 < binary.size())
+            {
+                switch (binary[i + 1])
+                {
+                case 0: return ShaderStage::Vertex;
+                case 1: return ShaderStage::TessControl;
+                case 2: return ShaderStage::TessEvaluation;
+                case 3: return ShaderStage::Geometry;
+                case 4: return ShaderStage::Fragment;
+                case 5: return ShaderStage::Compute;
+                default: return ShaderStage::None;
+                }
+            }
+            i += wordCount;
+        }
+        return ShaderStage::None;
+    }
     // 获取OpenGL Cache后缀字符串
     static Str ShaderStageCachedOpenGLFileExtension(const ShaderStage stage)
     {
@@ -132,6 +206,8 @@ namespace Utils::Shader
         case ShaderStage::Fragment: return ".cached_gl.frag";
         case ShaderStage::Compute:  return ".cached_gl.comp";
         case ShaderStage::Geometry: return ".cached_gl.geom";
+        case ShaderStage::TessControl:    return ".cached_gl.tesc";
+        case ShaderStage::TessEvaluation: return ".cached_gl.tese";
         default: PL_ASSERT(false,"No Support ShaderStage Type!");return "";
         }
     }
@@ -144,6 +220,8 @@ namespace Utils::Shader
         case ShaderStage::Fragment: return ".cached_vk.frag";
         case ShaderStage::Compute:  return ".cached_vk.comp";
         case ShaderStage::Geometry: return ".cached_vk.geom";
+        case ShaderStage::TessControl:    return ".cached_vk.tesc";
+        case ShaderStage::TessEvaluation: return ".cached_vk.tese";
         default: PL_ASSERT(false,"No Support ShaderStage Type!");return "";
         }
     }
@@ -156,6 +234,8 @@ namespace Utils::Shader
         case ShaderStage::Fragment: return ".cached_dx.frag";
         case ShaderStage::Compute:  return ".cached_dx.comp";
         case ShaderStage::Geometry: return ".cached_dx.geom";
+        case ShaderStage::TessControl:    return ".cached_dx.tesc";
+        case ShaderStage::TessEvaluation: return ".cached_dx.tese";
         default: PL_ASSERT(false,"No Support ShaderStage Type!");return "";
         }
     }
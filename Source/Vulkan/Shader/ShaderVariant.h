@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <algorithm>
+
+#include "Core/BaseType.h"
+#include "Core/Hash.h"
+
+/** @brief 宏定义 */
+struct ShaderMacro
+{
+    String Name;    ///< 宏名称
+    String Value;   ///< 宏的值
+
+    bool operator==(const ShaderMacro&) const = default;
+};
+
+/**
+ * @class ShaderVariantKey
+ * @brief Shader变体键
+ * @details
+ * 同一份源码使用不同宏定义编译出的结果称为变体 \n
+ * 宏按名称排序去重后哈希为64位，定义顺序不影响结果，同名宏以最后一次定义为准 \n
+ * 没有宏的键哈希为0，表示默认变体
+ */
+class ShaderVariantKey
+{
+public:
+    ShaderVariantKey() = default;
+    ShaderVariantKey(const std::initializer_list<ShaderMacro> macros)
+    {
+        for (const ShaderMacro& macro : macros)
+        {
+            Define(macro.Name, macro.Value);
+        }
+    }
+
+    /** 添加宏定义 */
+    ShaderVariantKey& Define(const String& name, const String& value = "1")
+    {
+        const auto it = std::ranges::lower_bound(m_Macros, name, {}, &ShaderMacro::Name);
+        if (it != m_Macros.end() && it->Name == name)
+            it->Value = value;
+        else
+            m_Macros.insert(it, {name, value});
+        UpdateHash();
+        return *this;
+    }
+
+    const Vector<ShaderMacro>& GetMacros() const { return m_Macros; }
+    u64 GetHash() const { return m_Hash; }
+    bool IsEmpty() const { return m_Macros.empty(); }
+
+    /** 用于日志，格式为 NAME=VALUE;NAME=VALUE */
+    String ToString() const
+    {
+        String result;
+        for (const ShaderMacro& macro : m_Macros)
+        {
+            if (!result.empty())
+                result += ';';
+            result += macro.Name + "=" + macro.Value;
+        }
+        return result;
+    }
+
+    bool operator==(const ShaderVariantKey& other) const { return m_Hash == other.m_Hash && m_Macros == other.m_Macros; }
+
+private:
+    void UpdateHash()
+    {
+        m_Hash = 0;
+        for (const ShaderMacro& macro : m_Macros)
+        {
+            m_Hash = Hash::Combine64(m_Hash, Hash::Hash64(macro.Name));
+            m_Hash = Hash::Combine64(m_Hash, Hash::Hash64(macro.Value));
+        }
+    }
+
+private:
+    Vector<ShaderMacro> m_Macros;   ///< 按名称排序的宏
+    u64 m_Hash {0};                 ///< 宏集合哈希
+};
@@ -1,24 +1,61 @@
 ﻿#include "VulkanShader.h"
 
+#include <ranges>
+
+#include "ShaderCache.h"
+#include "Core/Log/Log.h"
+
+#ifndef PL_SHADER_NO_COMPILER
+    #include "ShaderCompiler.h"
+    #include "ShaderDependency.h"
+#endif
+
 Shader::Shader(const File::Path& path)
+    : m_Name(path.stem().string())
+    , m_Path(std::filesystem::absolute(path).lexically_normal())
 {
     const auto extension = path.extension().string();
 
-    if (extension == ".glsl")
-    {
-        // 先编译成二进制
-
-        // 再读取
-    }
-    else if (extension == ".hlsl")
+    if (extension == ".glsl" || extension == ".hlsl")
     {
-        // 先编译成二进制
-
-        // 再读取
+#ifdef PL_SHADER_NO_COMPILER
+        // 不带编译器时只能使用离线预编译的归档
+        SPIRVBinaryViews binaries;
+        if (!ShaderCache::LoadBaked(ShaderCache::GetAssetName(m_Path), 0, binaries))
+        {
+            throw std::runtime_error("Shader is not in the baked archive: " + m_Path.string());
+        }
+        SetBinaries(binaries);
+#else
+        // 编译成二进制，命中缓存时直接读取
+        CacheCompileResult result = ShaderCompiler::CacheCompile(m_Path, ShaderAPIFlags::Vulkan);
+        if (!result.Success)
+        {
+            throw std::runtime_error("Failed to compile shader: " + m_Path.string());
+        }
+        m_Name = std::move(result.ShaderName);
+        SetBinaries(std::move(result.Sources));
+#endif
     }
     else if (extension == ".spv")
     {
-        // 读取
+        // 读取，阶段由入口点决定
+        const File::MappedFile file(m_Path);
+        if (!file.IsOpen() || file.GetSize() == 0 || file.GetSize() % sizeof(u32) != 0)
+        {
+            throw std::runtime_error("Invalid SPIR-V file: " + m_Path.string());
+        }
+        SPIRVBinary binary(file.GetSize() / sizeof(u32));
+        std::memcpy(binary.data(), file.GetData(), file.GetSize());
+
+        const ShaderStage stage = Utils::Shader::ShaderStageFromSPIRV(binary);
+        if (stage == ShaderStage::None)
+        {
+            throw std::runtime_error("SPIR-V file has no entry point: " + m_Path.string());
+        }
+        SPIRVBinaryDatas binaries;
+        binaries[stage] = std::move(binary);
+        SetBinaries(std::move(binaries));
     }
     else
     {
@@ -30,29 +67,332 @@ Shader::Shader(const String& code)
 {
 }
 
+Shader::Shader(String name, File::Path path, SPIRVBinaryDatas binaries, ShaderVariantKey variant)
+    : m_Name(std::move(name))
+    , m_Path(std::move(path))
+    , m_Variant(std::move(variant))
+{
+    SetBinaries(std::move(binaries));
+}
+
+Shader::Shader(String name, File::Path path, const SPIRVBinaryViews& mapped, ShaderVariantKey variant)
+    : m_Name(std::move(name))
+    , m_Path(std::move(path))
+    , m_Variant(std::move(variant))
+{
+    SetBinaries(mapped);
+}
+
 Shader::~Shader()
 {
 }
 
+Span<const u32> Shader::GetBinary(const ShaderStage stage) const
+{
+    const auto it = m_Stages.find(stage);
+    PL_ASSERT(it != m_Stages.end(), "Shader has no such stage!");
+    return it->second->GetCode();
+}
+
+VkShaderModule Shader::GetModule(const ShaderStage stage, const VkDevice device) const
+{
+    const auto it = m_Stages.find(stage);
+    if (it == m_Stages.end())
+        return VK_NULL_HANDLE;
+    return it->second->GetModule(device);
+}
+
+void Shader::SetBinaries(SPIRVBinaryDatas binaries)
+{
+    m_Reflection = ShaderReflection::ReflectAll(m_Name, binaries);
+    ShaderBlobPool& blobPool = ShaderBlobPool::Get();
+    for (auto& [stage, binary] : binaries)
+    {
+        m_Stages[stage] = blobPool.Intern(std::move(binary));
+    }
+}
+
+void Shader::SetBinaries(const SPIRVBinaryViews& mapped)
+{
+    m_Reflection = ShaderReflection::ReflectAll(m_Name, mapped);
+    ShaderBlobPool& blobPool = ShaderBlobPool::Get();
+    for (const auto& [stage, binary] : mapped)
+    {
+        m_Stages[stage] = blobPool.Intern(binary);
+    }
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    DisableHotReload();
+
+    // 变体编译任务引用了this，必须等它们结束
+    std::unique_lock lock(m_Mutex);
+    m_VariantCondition.wait(lock, [this] { return m_CompilingVariantCount == 0; });
+}
+
 void ShaderLibrary::Add(const SharedPtr<Shader>& shader)
 {
+    std::lock_guard lock(m_Mutex);
+    m_Shaders[shader->GetName()] = shader;
 }
 
 SharedPtr<Shader> ShaderLibrary::Load(const File::Path& path)
 {
-    return MakeShared<Shader>(path);
+    auto shader = MakeShared<Shader>(path);
+    Add(shader);
+    return shader;
 }
 
 SharedPtr<Shader> ShaderLibrary::Get(const String& name)
 {
-    return nullptr;
+    std::lock_guard lock(m_Mutex);
+    const auto it = m_Shaders.find(name);
+    return it != m_Shaders.end() ? it->second : nullptr;
 }
 
 bool ShaderLibrary::IsExists(const String& name) const
 {
-    return false;
+    std::lock_guard lock(m_Mutex);
+    return m_Shaders.contains(name);
 }
 
 void ShaderLibrary::Remove(const String& name)
 {
+    std::lock_guard lock(m_Mutex);
+    m_Shaders.erase(name);
+    DropVariants(name);
+}
+
+SharedPtr<Shader> ShaderLibrary::GetVariant(const String& name, const ShaderVariantKey& variant)
+{
+    if (variant.IsEmpty())
+        return Get(name);
+
+    std::lock_guard lock(m_Mutex);
+    const auto key = std::pair(name, variant.GetHash());
+    if (const auto it = m_Variants.find(key); it != m_Variants.end())
+    {
+        it->second.LastUsed = Now();
+        return it->second.Instance;
+    }
+
+    // 变体从默认变体的源文件编译
+    const auto shaderIt = m_Shaders.find(name);
+    if (shaderIt == m_Shaders.end() || shaderIt->second->GetPath().extension() == ".spv")
+        return nullptr;
+
+    VariantEntry& entry = m_Variants[key];
+    entry.LastUsed   = Now();
+    entry.Generation = ++m_VariantGeneration;
+
+#ifdef PL_SHADER_NO_COMPILER
+    // 预编译的变体只需要在归档中查找，直接同步读取
+    if (SPIRVBinaryViews binaries; ShaderCache::LoadBaked(ShaderCache::GetAssetName(shaderIt->second->GetPath()), variant.GetHash(), binaries))
+        entry.Instance = MakeShared<Shader>(name, shaderIt->second->GetPath(), binaries, variant);
+    else
+    {
+        Log::CatError("Shader", "Variant '{0}' of shader '{1}' is not in the baked archive", variant.ToString(), name);
+        entry.Failed = true;
+    }
+    return entry.Instance;
+#else
+    entry.Compiling = true;
+    ++m_CompilingVariantCount;
+
+    ShaderCompiler::GetThreadPool().Submit([this, key, path = shaderIt->second->GetPath(), variant, generation = entry.Generation]
+    {
+        // 变体宏来自调用者，编译失败只记录错误，不能断言
+        SharedPtr<Shader> shader;
+        String errorMessage;
+        try
+        {
+            CacheCompileResult result = ShaderCompiler::TryCacheCompile(path, ShaderAPIFlags::Vulkan, variant);
+            if (result.Success)
+                shader = MakeShared<Shader>(key.first, path, std::move(result.Sources), variant);
+            else
+                errorMessage = std::move(result.ErrorMessage);
+        }
+        catch (const std::exception& e)
+        {
+            errorMessage = e.what();
+        }
+        if (!shader)
+            Log::CatError("Shader", "Failed to compile variant '{0}' (key {1:016x}) of shader '{2}': {3}",
+                variant.ToString(), key.second, key.first, errorMessage);
+
+        std::lock_guard lock(m_Mutex);
+        if (const auto it = m_Variants.find(key); it != m_Variants.end() && it->second.Generation == generation)
+        {
+            it->second.Failed    = shader == nullptr;
+            it->second.Instance  = std::move(shader);
+            it->second.Compiling = false;
+        }
+        --m_CompilingVariantCount;
+        m_VariantCondition.notify_all();
+    });
+    return nullptr;
+#endif
+}
+
+bool ShaderLibrary::IsVariantFailed(const String& name, const ShaderVariantKey& variant) const
+{
+    std::lock_guard lock(m_Mutex);
+    const auto it = m_Variants.find(std::pair(name, variant.GetHash()));
+    return it != m_Variants.end() && it->second.Failed;
+}
+
+size_t ShaderLibrary::EvictUnusedVariants(const f64 idleSeconds)
+{
+    const TimePoint now = Now();
+    std::lock_guard lock(m_Mutex);
+    return std::erase_if(m_Variants, [&](const VariantMap::value_type& item)
+    {
+        return !item.second.Compiling && Elapsed(item.second.LastUsed, now).count() > idleSeconds;
+    });
+}
+
+void ShaderLibrary::DropVariants(const String& name)
+{
+    std::erase_if(m_Variants, [&](const VariantMap::value_type& item) { return item.first.first == name; });
+}
+
+void ShaderLibrary::EnableHotReload(const File::Path& directory)
+{
+#ifdef PL_SHADER_NO_COMPILER
+    Log::CatWarn("Shader", "Shader hot reload needs the shader compiler, ignoring '{0}'", directory.string());
+#else
+    DisableHotReload();
+
+    m_StopReload = false;
+    m_ReloadThread = std::thread([this] { ReloadWorker(); });
+    m_Watcher = MakeUnique<File::FileWatcher>(std::filesystem::absolute(directory), [this](const Set<File::Path>& changedFiles)
+    {
+        {
+            std::lock_guard lock(m_ReloadMutex);
+            m_ChangedFiles.insert(changedFiles.begin(), changedFiles.end());
+        }
+        m_ReloadCondition.notify_one();
+    });
+    Log::CatInfo("Shader", "Shader hot reload watching '{0}'", directory.string());
+#endif
+}
+
+void ShaderLibrary::DisableHotReload()
+{
+    // 先停止监视，之后不会再有新的修改进入队列
+    m_Watcher.reset();
+    {
+        std::lock_guard lock(m_ReloadMutex);
+        m_StopReload = true;
+        m_ChangedFiles.clear();
+    }
+    m_ReloadCondition.notify_one();
+    if (m_ReloadThread.joinable())
+        m_ReloadThread.join();
+}
+
+Vector<String> ShaderLibrary::ApplyPendingReloads()
+{
+    Vector<SharedPtr<Shader>> pendingReloads;
+    {
+        std::lock_guard lock(m_ReloadMutex);
+        pendingReloads.swap(m_PendingReloads);
+    }
+
+    Vector<String> reloadedNames;
+    if (pendingReloads.empty())
+        return reloadedNames;
+
+    std::lock_guard lock(m_Mutex);
+    for (auto& shader : pendingReloads)
+    {
+        // 编译期间被移除的shader不再加回
+        const auto it = m_Shaders.find(shader->GetName());
+        if (it == m_Shaders.end())
+            continue;
+
+        it->second = std::move(shader);
+        DropVariants(it->first);
+        if (std::ranges::find(reloadedNames, it->first) == reloadedNames.end())
+            reloadedNames.push_back(it->first);
+    }
+    return reloadedNames;
+}
+
+void ShaderLibrary::ReloadWorker()
+{
+#ifndef PL_SHADER_NO_COMPILER
+    while (true)
+    {
+        Set<File::Path> changedFiles;
+        {
+            std::unique_lock lock(m_ReloadMutex);
+            m_ReloadCondition.wait(lock, [this] { return m_StopReload || !m_ChangedFiles.empty(); });
+            if (m_StopReload)
+                return;
+            changedFiles.swap(m_ChangedFiles);
+        }
+
+        // 源文件本身被修改，或者它包含的文件被修改，都需要重新编译
+        Vector<File::Path> reloadPaths;
+        {
+            ShaderDependencyGraph& dependencyGraph = ShaderDependencyGraph::Get();
+            std::lock_guard lock(m_Mutex);
+            for (const auto& shader : m_Shaders | std::views::values)
+            {
+                const File::Path& path = shader->GetPath();
+                const bool affected = std::ranges::any_of(changedFiles, [&](const File::Path& changedFile)
+                {
+                    if (changedFile == path)
+                        return true;
+                    return std::ranges::any_of(shader->GetStages() | std::views::keys, [&](const ShaderStage stage)
+                    {
+                        return dependencyGraph.DependsOn(ShaderDependencyGraph::MakeUnitName(path, stage), changedFile);
+                    });
+                });
+                if (affected && path.extension() != ".spv")
+                    reloadPaths.push_back(path);
+            }
+        }
+
+        for (const File::Path& path : reloadPaths)
+        {
+            // 编译前记录输入的修改时间，编译后比较以发现编译期间发生的修改
+            const ShaderDependencyGraph::WriteTimes inputTimes = ShaderDependencyGraph::Get().SnapshotWriteTimes(path);
+
+            // 监视目录中的文件随时可能有语法错误，不能走会断言的编译路径
+            CacheCompileResult result = ShaderCompiler::TryCacheCompile(path, ShaderAPIFlags::Vulkan);
+
+            // 编译期间文件可能又被修改，而修改通知可能在编译前就已被取走，此时结果已过期，重新排队编译
+            if (ShaderDependencyGraph::HasChanged(inputTimes))
+            {
+                Log::CatInfo("Shader", "Shader '{0}' changed while compiling, recompiling", path.string());
+                std::lock_guard lock(m_ReloadMutex);
+                m_ChangedFiles.insert(path);
+                continue;
+            }
+            if (!result.Success)
+            {
+                Log::CatError("Shader", "Failed to reload shader '{0}', keeping the previous version: {1}", path.string(), result.ErrorMessage);
+                continue;
+            }
+
+            SharedPtr<Shader> shader;
+            try
+            {
+                shader = MakeShared<Shader>(std::move(result.ShaderName), path, std::move(result.Sources));
+            }
+            catch (const std::exception& e)
+            {
+                Log::CatError("Shader", "Failed to reload shader '{0}', keeping the previous version: {1}", path.string(), e.what());
+                continue;
+            }
+
+            Log::CatInfo("Shader", "Shader '{0}' reloaded", shader->GetName());
+            std::lock_guard lock(m_ReloadMutex);
+            m_PendingReloads.push_back(std::move(shader));
+        }
+    }
+#endif
 }
@@ -1,22 +1,76 @@
 ﻿#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "ShaderBlob.h"
+#include "ShaderReflection.h"
+#include "ShaderUtils.h"
+#include "ShaderVariant.h"
 #include "../VulkanUtils.h"
 #include "../Core/BaseType.h"
 #include "../Core/FileSystem.h"
+#include "../Core/FileWatcher.h"
 
 
 
+/**
+ * @class Shader
+ * @brief Shader资源，持有各阶段的Vulkan SPIR-V二进制和合并后的反射数据
+ * @details 阶段二进制由ShaderBlobPool去重，内容相同的阶段在shader之间共享同一份二进制和VkShaderModule
+ */
 class Shader
 {
 public:
     Shader(const File::Path& path);
     Shader(const String& code);
+    Shader(String name, File::Path path, SPIRVBinaryDatas binaries, ShaderVariantKey variant = {});
+    /** 二进制直接引用映射的归档，不复制，归档需要在shader释放前保持挂载 */
+    Shader(String name, File::Path path, const SPIRVBinaryViews& mapped, ShaderVariantKey variant = {});
     ~Shader();
+
+    const String& GetName() const { return m_Name; }
+    const File::Path& GetPath() const { return m_Path; }
+    const Map<ShaderStage, SharedPtr<const ShaderBlob>>& GetStages() const { return m_Stages; }
+    const ShaderVariantKey& GetVariant() const { return m_Variant; }
+    const ShaderReflectionData& GetReflection() const { return m_Reflection; }
+
+    bool HasStage(ShaderStage stage) const { return m_Stages.contains(stage); }
+
+    /** 获取阶段二进制，阶段不存在时断言 */
+    Span<const u32> GetBinary(ShaderStage stage) const;
+
+    /** 获取阶段的VkShaderModule，与其他内容相同的阶段共享，生命周期由二进制管理，调用者不要销毁 */
+    VkShaderModule GetModule(ShaderStage stage, VkDevice device) const;
+
+private:
+    // 反射并去重各阶段二进制
+    void SetBinaries(SPIRVBinaryDatas binaries);
+    void SetBinaries(const SPIRVBinaryViews& mapped);
+
+private:
+    String m_Name;                      ///< 名称
+    File::Path m_Path;                  ///< 源文件路径
+    Map<ShaderStage, SharedPtr<const ShaderBlob>> m_Stages; ///< 各阶段共享的二进制
+    ShaderVariantKey m_Variant;         ///< 变体宏定义，默认变体为空
+    ShaderReflectionData m_Reflection;  ///< 反射数据
 };
 
+/**
+ * @class ShaderLibrary
+ * @brief Shader库
+ * @details
+ * 开启热重载后，监视目录中的源文件或其包含文件被修改时，后台线程重新编译受影响的shader \n
+ * 编译结果先放入待替换队列，由主线程在帧边界调用ApplyPendingReloads一次性替换，主线程不会等待编译 \n
+ * 编译失败时保留旧的shader，编译期间源文件或包含文件再次被修改时丢弃结果并重新编译 \n
+ * 变体只在第一次被请求时才提交到后台编译，长时间未使用的变体可以被逐出，逐出后磁盘缓存仍然保留
+ */
 class ShaderLibrary
 {
     using ShaderMap = Map<String, SharedPtr<Shader>>;
 public:
+    ~ShaderLibrary();
+
     void Add(const SharedPtr<Shader>& shader);
     SharedPtr<Shader> Load(const File::Path& path);
     SharedPtr<Shader> Get(const String& name);
@@ -24,8 +78,64 @@ public:
     bool IsExists(const String& name) const ;
     void Remove(const String& name);
 
+    /**
+     * @brief 获取变体
+     * @details 第一次请求时提交到编译线程池，编译完成前返回nullptr，调用者可以先使用默认变体
+     * @note 编译失败的变体在源文件被热重载或变体被逐出前不会重试，可以用IsVariantFailed区分失败和编译中
+     */
+    SharedPtr<Shader> GetVariant(const String& name, const ShaderVariantKey& variant);
+
+    /** 变体是否编译失败 */
+    bool IsVariantFailed(const String& name, const ShaderVariantKey& variant) const;
+
+    /** 逐出超过idleSeconds没有被请求过的变体，返回逐出数量 */
+    size_t EvictUnusedVariants(f64 idleSeconds);
+
+    /** 开启热重载，监视目录下的文件修改 */
+    void EnableHotReload(const File::Path& directory);
+
+    /** 关闭热重载，等待正在进行的编译结束 */
+    void DisableHotReload();
+
+    /**
+     * @brief 替换后台已编译完成的shader
+     * @note 在帧边界由主线程调用，调用者负责重建引用了这些shader的管线，被替换shader的变体会被丢弃并在下次请求时重新编译
+     * @return 被替换的shader名称
+     */
+    Vector<String> ApplyPendingReloads();
+
 private:
+    // 后台编译线程
+    void ReloadWorker();
+
+    // 丢弃某个shader的所有变体，正在编译的变体完成后会被忽略，调用前需持有m_Mutex
+    void DropVariants(const String& name);
+
+private:
+    struct VariantEntry
+    {
+        SharedPtr<Shader> Instance;     ///< 编译完成的变体，编译中或失败时为空
+        TimePoint LastUsed;             ///< 最后一次请求的时间
+        u64 Generation {0};             ///< 提交编译时的代数，用于忽略过期的编译结果
+        bool Compiling {false};         ///< 是否正在编译
+        bool Failed {false};            ///< 编译失败，Instance为空
+    };
+    using VariantMap = Map<std::pair<String, u64>, VariantEntry>;
+
     ShaderMap m_Shaders;
+    VariantMap m_Variants;                              ///< (名称, 变体哈希) -> 变体
+    u64 m_VariantGeneration {0};                        ///< 变体编译代数
+    u32 m_CompilingVariantCount {0};                    ///< 正在编译的变体数量
+    std::condition_variable m_VariantCondition;         ///< 变体编译完成时通知
+    mutable std::mutex m_Mutex;                         ///< 保护以上数据，编译线程会访问
+
+    UniquePtr<File::FileWatcher> m_Watcher;             ///< 文件监视器
+    std::thread m_ReloadThread;                         ///< 后台编译线程
+    std::mutex m_ReloadMutex;                           ///< 保护以下热重载数据
+    std::condition_variable m_ReloadCondition;          ///< 有修改或停止时唤醒编译线程
+    Set<File::Path> m_ChangedFiles;                     ///< 等待处理的修改文件
+    Vector<SharedPtr<Shader>> m_PendingReloads;         ///< 等待替换的shader
+    bool m_StopReload {false};                          ///< 是否停止编译线程
 };
 
 class Material
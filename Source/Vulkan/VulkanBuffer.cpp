@@ -0,0 +1,82 @@
+﻿#include "VulkanBuffer.h"
+
+#include <stdexcept>
+
+#include "VulkanUtils.h"
+
+VulkanBuffer::VulkanBuffer(const VulkanAllocator& allocator, const VkDeviceSize size, const VkBufferUsageFlags usage, const VulkanMemoryUsage memoryUsage)
+    : m_Allocator(allocator.GetHandle()), m_Size(size), m_MemoryUsage(memoryUsage)
+{
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = size;
+    bufferInfo.usage       = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // 设备本地的缓冲区需要通过传输命令写入
+    if (memoryUsage == VulkanMemoryUsage::GpuOnly)
+        bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    const VmaAllocationCreateInfo allocationInfo = VulkanAllocator::MakeAllocationCreateInfo(memoryUsage);
+    VmaAllocationInfo result {};
+    if (vmaCreateBuffer(m_Allocator, &bufferInfo, &allocationInfo, &m_Buffer, &m_Allocation, &result) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create buffer");
+
+    m_MappedData = result.pMappedData;
+}
+
+VulkanBuffer::~VulkanBuffer()
+{
+    Destroy();
+}
+
+VulkanBuffer::VulkanBuffer(VulkanBuffer&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+VulkanBuffer& VulkanBuffer::operator=(VulkanBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Destroy();
+        m_Allocator   = std::exchange(other.m_Allocator, VK_NULL_HANDLE);
+        m_Buffer      = std::exchange(other.m_Buffer, VK_NULL_HANDLE);
+        m_Allocation  = std::exchange(other.m_Allocation, VK_NULL_HANDLE);
+        m_Size        = std::exchange(other.m_Size, 0);
+        m_MemoryUsage = other.m_MemoryUsage;
+        m_MappedData  = std::exchange(other.m_MappedData, nullptr);
+    }
+    return *this;
+}
+
+void VulkanBuffer::Write(const void* data, const VkDeviceSize size, const VkDeviceSize offset)
+{
+    PL_ASSERT(m_MappedData, "Buffer is not host visible");
+    PL_ASSERT(offset + size <= m_Size, "Buffer write out of range");
+    std::memcpy(static_cast<u8*>(m_MappedData) + offset, data, size);
+    Flush(offset, size);
+}
+
+void VulkanBuffer::Flush(const VkDeviceSize offset, const VkDeviceSize size)
+{
+    // VMA对HOST_COHERENT内存直接返回
+    vmaFlushAllocation(m_Allocator, m_Allocation, offset, size);
+}
+
+void VulkanBuffer::Invalidate(const VkDeviceSize offset, const VkDeviceSize size)
+{
+    vmaInvalidateAllocation(m_Allocator, m_Allocation, offset, size);
+}
+
+void VulkanBuffer::Destroy()
+{
+    if (m_Buffer == VK_NULL_HANDLE)
+        return;
+
+    vmaDestroyBuffer(m_Allocator, m_Buffer, m_Allocation);
+    m_Buffer     = VK_NULL_HANDLE;
+    m_Allocation = VK_NULL_HANDLE;
+    m_MappedData = nullptr;
+    m_Size       = 0;
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "Core/BaseType.h"
+#include "VulkanMemory.h"
+
+/**
+ * @class VulkanBuffer
+ * @brief 从VulkanAllocator分配的缓冲区
+ * @details
+ * 内存类型由VulkanMemoryUsage决定，除GpuOnly外都是持久映射的，可以直接Write \n
+ * 只能移动不能拷贝，析构时释放缓冲区和内存，调用者需要保证GPU已经不再使用
+ */
+class VulkanBuffer
+{
+public:
+    VulkanBuffer() = default;
+    VulkanBuffer(const VulkanAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, VulkanMemoryUsage memoryUsage);
+    ~VulkanBuffer();
+
+    VulkanBuffer(const VulkanBuffer&) = delete;
+    VulkanBuffer& operator=(const VulkanBuffer&) = delete;
+    VulkanBuffer(VulkanBuffer&& other) noexcept;
+    VulkanBuffer& operator=(VulkanBuffer&& other) noexcept;
+
+    VkBuffer GetHandle() const { return m_Buffer; }
+    VkDeviceSize GetSize() const { return m_Size; }
+    VulkanMemoryUsage GetMemoryUsage() const { return m_MemoryUsage; }
+
+    /** 映射后的地址，GpuOnly的缓冲区为nullptr */
+    void* GetMappedData() const { return m_MappedData; }
+    bool IsMapped() const { return m_MappedData != nullptr; }
+
+    /** 写入映射内存，内存不是HOST_COHERENT时自动刷新 */
+    void Write(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+    /** 刷新CPU写入的范围，使GPU可见 */
+    void Flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    /** 使GPU写入的范围对CPU可见 */
+    void Invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    /** 释放缓冲区 */
+    void Destroy();
+
+private:
+    VmaAllocator m_Allocator {VK_NULL_HANDLE};              ///< 分配器
+    VkBuffer m_Buffer {VK_NULL_HANDLE};                     ///< 缓冲区
+    VmaAllocation m_Allocation {VK_NULL_HANDLE};            ///< 内存分配
+    VkDeviceSize m_Size {0};                                ///< 缓冲区大小
+    VulkanMemoryUsage m_MemoryUsage {VulkanMemoryUsage::GpuOnly}; ///< 内存用途
+    void* m_MappedData {nullptr};                           ///< 持久映射地址
+};
@@ -1,6 +1,8 @@
 ﻿#include "VulkanContext.h"
 
 #include "VulkanUtils.h"
+#include "Shader/ShaderBlob.h"
+#include "Core/Log/Log.h"
 
 VulkanContext::VulkanContext()
     : m_PhysicalDevice(VK_NULL_HANDLE), m_Device(VK_NULL_HANDLE), m_Surface(VK_NULL_HANDLE)
@@ -8,6 +10,20 @@ VulkanContext::VulkanContext()
 }
 VulkanContext::~VulkanContext()
 {
+    // 销毁管线和着色器模块前等待GPU用完它们
+    if (m_Device != VK_NULL_HANDLE)
+        vkDeviceWaitIdle(m_Device);
+    m_PipelineLog.Save();
+    m_PipelineRegistry.Destroy();
+    // 共享的VkShaderModule属于这个设备，必须在设备销毁前释放
+    ShaderBlobPool::Get().DestroyModules();
+    // 管线缓存在设备销毁前写回磁盘
+    m_PipelineCache.Destroy();
+    m_FrameAllocator.Destroy();
+    m_StagingRing.Destroy();
+    // 延迟销毁的资源可能来自分配器，需要在分配器之前执行
+    m_Scheduler.Destroy();
+    m_Allocator.Destroy();
     if (m_Device != VK_NULL_HANDLE)
         vkDestroyDevice(m_Device, nullptr);
     if (m_Surface != VK_NULL_HANDLE)
@@ -108,13 +124,42 @@ void VulkanContext::CreateLogicalDevice()
     // 设备功能
     VkPhysicalDeviceFeatures deviceFeatures{};
 
+    // 扩展动态状态可用时开启，只有剔除和深度状态不同的管线可以共享
+    DynamicArray<Str> deviceExtensions = m_DeviceExtensions;
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    const bool hasExtendedDynamicState = HasDeviceExtension(m_PhysicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+    // Vulkan 1.2的时间线信号量用于提交调度
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext = hasExtendedDynamicState ? &extendedDynamicStateFeatures : nullptr;
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features2);
+
+    m_ExtendedDynamicState = extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+    if (m_ExtendedDynamicState)
+        deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    m_TimelineSemaphore = vulkan12Features.timelineSemaphore == VK_TRUE;
+
+    // 只开启用到的1.2功能
+    VkPhysicalDeviceVulkan12Features enabledVulkan12Features{};
+    enabledVulkan12Features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    enabledVulkan12Features.pNext             = m_ExtendedDynamicState ? &extendedDynamicStateFeatures : nullptr;
+    enabledVulkan12Features.timelineSemaphore = m_TimelineSemaphore ? VK_TRUE : VK_FALSE;
+    extendedDynamicStateFeatures.pNext        = nullptr;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext                   = &enabledVulkan12Features;
     createInfo.pQueueCreateInfos       = queueCreateInfos.data();
     createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures        = &deviceFeatures;
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(m_DeviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
+    createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
     if (m_EnableValidationLayers)
     {
@@ -132,6 +177,23 @@ void VulkanContext::CreateLogicalDevice()
     vkGetDeviceQueue(m_Device, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
     vkGetDeviceQueue(m_Device, indices.presentFamily.value(), 0, &m_PresentQueue);
 
+    m_Allocator.Create(s_VulkanInstance, m_PhysicalDevice, m_Device, VK_API_VERSION_1_2);
+    m_Scheduler.Create(m_Device);
+    m_StagingRing.Create(m_Allocator, m_GraphicsQueue, indices.graphicsFamily.value());
+    if (m_TimelineSemaphore)
+    {
+        // 暂存缓冲区的批次通过图形队列的时间线回收
+        m_StagingRing.SetTimeline(&m_Scheduler.AddQueue(VulkanQueueType::Graphics, m_GraphicsQueue));
+    }
+    else
+    {
+        Log::CatWarn("Vulkan", "Timeline semaphores are not supported, falling back to fences");
+    }
+    m_FrameAllocator.Create(m_Allocator, m_PhysicalDevice, MaxFramesInFlight);
+    m_PipelineCache.Create(m_PhysicalDevice, m_Device);
+    m_PipelineRegistry.Create(m_Device, m_PipelineCache.GetHandle(), m_ExtendedDynamicState);
+    m_PipelineLog.Open();
+    m_PipelineRegistry.SetLog(&m_PipelineLog);
 }
 
 QueueFamilyIndices VulkanContext::FindQueueFamilies(VkPhysicalDevice device) const
@@ -245,6 +307,19 @@ bool VulkanContext::CheckDeviceExtensionSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool VulkanContext::HasDeviceExtension(VkPhysicalDevice device, Str name) const
+{
+    u32 extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    DynamicArray<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    return std::ranges::any_of(availableExtensions, [name](const VkExtensionProperties& extension) {
+        return strcmp(extension.extensionName, name) == 0;
+    });
+}
+
 bool VulkanContext::IsDeviceSuitable(VkPhysicalDevice device)
 {
     QueueFamilyIndices indices {FindQueueFamilies(device)};
@@ -1,6 +1,13 @@
 ﻿#pragma once
 #include "Core/BaseType.h"
 #include "Vulkan.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanMemory.h"
+#include "VulkanPipeline.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanPipelineLog.h"
+#include "VulkanScheduler.h"
+#include "VulkanStagingRing.h"
 
 /**
  * @struct QueueFamilyIndices
@@ -42,6 +49,8 @@ struct SwapChainSupportDetails
 class VulkanContext
 {
 public:
+    static constexpr u32 MaxFramesInFlight = 2;   ///< 同时在GPU上执行的最大帧数
+
     /** 获取单例 */
     static VulkanContext& Get()
     {
@@ -83,6 +92,24 @@ public:
     /** 获取呈现队列*/
     VkQueue GetPresentQueue() const { return m_PresentQueue;}
 
+    /** 获取内存分配器，所有缓冲区和图像都应从这里分配*/
+    VulkanAllocator& GetAllocator() { return m_Allocator;}
+    /** 获取暂存环形缓冲区，上传到设备本地资源*/
+    VulkanStagingRing& GetStagingRing() { return m_StagingRing;}
+    /** 获取提交调度器，不支持时间线信号量时没有注册任何队列*/
+    VulkanScheduler& GetScheduler() { return m_Scheduler;}
+    /** 是否启用了时间线信号量*/
+    bool HasTimelineSemaphore() const { return m_TimelineSemaphore;}
+    /** 获取每帧线性分配器，uniform和动态顶点数据从这里分配*/
+    VulkanFrameAllocator& GetFrameAllocator() { return m_FrameAllocator;}
+
+    /** 获取管线缓存，所有管线创建都应使用它*/
+    VulkanPipelineCache& GetPipelineCache() { return m_PipelineCache;}
+    VulkanPipelineRegistry& GetPipelineRegistry() { return m_PipelineRegistry;}
+    VulkanPipelineLog& GetPipelineLog() { return m_PipelineLog;}
+    /** 是否启用了扩展动态状态*/
+    bool HasExtendedDynamicState() const { return m_ExtendedDynamicState;}
+
     void Init();
 
     VulkanContext();
@@ -97,6 +124,8 @@ private:
     DynamicArray<Str> GetRequiredExtensions() const;
     /** 检查设备扩展支持*/
     bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+    /** 检查设备是否支持某个可选扩展*/
+    bool HasDeviceExtension(VkPhysicalDevice device, Str name) const;
     /** 检查设备是否适合*/
     bool IsDeviceSuitable(VkPhysicalDevice device);
 
@@ -115,6 +144,16 @@ private:
     VkQueue m_GraphicsQueue;                       ///< 图形队列
     VkQueue m_PresentQueue;                        ///< 呈现队列
     VkQueue m_ComputeQueue;                        ///< 计算队列
+    bool m_ExtendedDynamicState {false};           ///< 是否启用了VK_EXT_extended_dynamic_state
+    bool m_TimelineSemaphore {false};              ///< 是否启用了时间线信号量
+
+    VulkanAllocator m_Allocator;                   ///< VMA内存分配器，随逻辑设备创建和销毁
+    VulkanScheduler m_Scheduler;                   ///< 基于时间线信号量的提交调度器
+    VulkanStagingRing m_StagingRing;               ///< 在图形队列上提交的暂存环形缓冲区
+    VulkanFrameAllocator m_FrameAllocator;         ///< 每帧线性分配器，按飞行帧数划分区域
+    VulkanPipelineCache m_PipelineCache;           ///< 持久化的管线缓存，随逻辑设备创建和销毁
+    VulkanPipelineRegistry m_PipelineRegistry;     ///< 管线注册表，相同描述的管线只创建一次
+    VulkanPipelineLog m_PipelineLog;               ///< 管线预热日志，记录注册表创建过的所有描述
 
 #ifdef NDEBUG
     const bool m_EnableValidationLayers = false;   ///< 不启用验证层,验证层用于检测和报告Vulkan应用程序中的错误和警告。
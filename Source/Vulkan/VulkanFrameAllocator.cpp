@@ -0,0 +1,70 @@
+﻿#include "VulkanFrameAllocator.h"
+
+#include "VulkanUtils.h"
+#include "Core/Log/Log.h"
+
+void VulkanFrameAllocator::Create(const VulkanAllocator& allocator, const VkPhysicalDevice physicalDevice, const u32 frameCount, const VkDeviceSize frameSize)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_UniformAlignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+    m_StorageAlignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 16);
+
+    // 每帧区域的起点也要满足对齐，分配到的偏移才能直接用作动态偏移
+    m_FrameCount = std::max(frameCount, 1u);
+    m_FrameSize  = AlignUp(frameSize, std::max(m_UniformAlignment, m_StorageAlignment));
+    m_FrameBase  = 0;
+    m_Offset.store(0, std::memory_order_relaxed);
+
+    constexpr VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    m_Buffer = VulkanBuffer(allocator, m_FrameSize * m_FrameCount, usage, VulkanMemoryUsage::Dynamic);
+}
+
+void VulkanFrameAllocator::Destroy()
+{
+    m_Buffer.Destroy();
+    m_FrameCount = 0;
+    m_FrameSize  = 0;
+    m_FrameBase  = 0;
+    m_Offset.store(0, std::memory_order_relaxed);
+}
+
+void VulkanFrameAllocator::BeginFrame(const u32 frameIndex)
+{
+    PL_ASSERT(frameIndex < m_FrameCount, "Frame index out of range");
+    m_FrameBase = m_FrameSize * frameIndex;
+    m_Offset.store(0, std::memory_order_relaxed);
+}
+
+void VulkanFrameAllocator::Flush()
+{
+    const VkDeviceSize used = std::min(m_Offset.load(std::memory_order_relaxed), m_FrameSize);
+    if (used > 0)
+        m_Buffer.Flush(m_FrameBase, used);
+}
+
+VulkanFrameAllocation VulkanFrameAllocator::Allocate(const VkDeviceSize size, const VkDeviceSize alignment)
+{
+    PL_ASSERT(m_Buffer.IsMapped(), "Frame allocator is not created");
+
+    // 多个录制线程同时分配时用CAS推进偏移
+    VkDeviceSize current = m_Offset.load(std::memory_order_relaxed);
+    VkDeviceSize offset {0};
+    do
+    {
+        offset = AlignUp(current, alignment);
+        if (offset + size > m_FrameSize)
+        {
+            Log::CatError("Vulkan", "Frame allocator out of space: {0} of {1} bytes used, {2} requested", current, m_FrameSize, size);
+            return {};
+        }
+    } while (!m_Offset.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+    VulkanFrameAllocation allocation;
+    allocation.Buffer = m_Buffer.GetHandle();
+    allocation.Offset = m_FrameBase + offset;
+    allocation.Size   = size;
+    allocation.Data   = static_cast<u8*>(m_Buffer.GetMappedData()) + allocation.Offset;
+    return allocation;
+}
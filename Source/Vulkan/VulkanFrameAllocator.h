@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <atomic>
+
+#include "Core/BaseType.h"
+#include "VulkanBuffer.h"
+
+/** @brief 帧内分配结果，Data为nullptr表示空间不足 */
+struct VulkanFrameAllocation
+{
+    VkBuffer Buffer {VK_NULL_HANDLE};   ///< 所在缓冲区，所有分配共用同一个
+    VkDeviceSize Offset {0};            ///< 在缓冲区中的偏移，可直接作为动态偏移或绑定偏移
+    VkDeviceSize Size {0};              ///< 大小
+    void* Data {nullptr};               ///< 映射地址
+
+    explicit operator bool() const { return Data != nullptr; }
+};
+
+/**
+ * @class VulkanFrameAllocator
+ * @brief 每帧的线性分配器
+ * @details
+ * 一块持久映射的Dynamic缓冲区按飞行帧数平分，每帧只在自己的区域内向后分配 \n
+ * 用于uniform、动态顶点数据和间接绘制参数等只在一帧内有效的数据，不需要为每次绘制创建缓冲区 \n
+ * uniform绑定为UNIFORM_BUFFER_DYNAMIC后，每次绘制只需传入不同的动态偏移，不需要更新描述符 \n
+ * BeginFrame重置该帧的区域，调用者需要保证该帧上一次提交的栅栏已经触发 \n
+ * Allocate可以在多个线程中同时调用，BeginFrame和Flush需要在录制线程之外单独调用
+ */
+class VulkanFrameAllocator
+{
+public:
+    static constexpr VkDeviceSize DefaultFrameSize = 4ull << 20;
+
+    VulkanFrameAllocator() = default;
+    ~VulkanFrameAllocator() = default;
+
+    VulkanFrameAllocator(const VulkanFrameAllocator&) = delete;
+    VulkanFrameAllocator& operator=(const VulkanFrameAllocator&) = delete;
+
+    /** 创建缓冲区，每帧frameSize字节 */
+    void Create(const VulkanAllocator& allocator, VkPhysicalDevice physicalDevice, u32 frameCount, VkDeviceSize frameSize = DefaultFrameSize);
+
+    /** 释放缓冲区，调用者需要保证GPU已经不再使用 */
+    void Destroy();
+
+    /** 开始新的一帧，重置frameIndex对应的区域 */
+    void BeginFrame(u32 frameIndex);
+
+    /** 刷新当前帧写入的范围，在提交本帧命令前调用 */
+    void Flush();
+
+    /** 按alignment对齐分配 */
+    VulkanFrameAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    /** 分配满足minUniformBufferOffsetAlignment的uniform数据 */
+    VulkanFrameAllocation AllocateUniform(VkDeviceSize size) { return Allocate(size, m_UniformAlignment); }
+
+    /** 分配满足minStorageBufferOffsetAlignment的storage数据 */
+    VulkanFrameAllocation AllocateStorage(VkDeviceSize size) { return Allocate(size, m_StorageAlignment); }
+
+    /** 分配并写入一个uniform结构体 */
+    template<typename T>
+    VulkanFrameAllocation PushUniform(const T& value)
+    {
+        VulkanFrameAllocation allocation = AllocateUniform(sizeof(T));
+        if (allocation)
+            std::memcpy(allocation.Data, &value, sizeof(T));
+        return allocation;
+    }
+
+    VkBuffer GetBuffer() const { return m_Buffer.GetHandle(); }
+    VkDeviceSize GetFrameSize() const { return m_FrameSize; }
+
+    /** 当前帧已经使用的字节数 */
+    VkDeviceSize GetUsedSize() const { return m_Offset.load(std::memory_order_relaxed); }
+
+private:
+    VulkanBuffer m_Buffer;                          ///< 所有帧共用的缓冲区
+    VkDeviceSize m_FrameSize {0};                   ///< 每帧区域大小
+    VkDeviceSize m_FrameBase {0};                   ///< 当前帧区域的起始偏移
+    std::atomic<VkDeviceSize> m_Offset {0};         ///< 当前帧区域内下一次分配的偏移
+    VkDeviceSize m_UniformAlignment {16};           ///< uniform偏移对齐
+    VkDeviceSize m_StorageAlignment {16};           ///< storage偏移对齐
+    u32 m_FrameCount {0};                           ///< 帧数
+};
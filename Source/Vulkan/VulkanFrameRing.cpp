@@ -0,0 +1,241 @@
+﻿#include "VulkanFrameRing.h"
+
+#include "VulkanFrameAllocator.h"
+#include "VulkanUtils.h"
+
+VulkanFrameRing::~VulkanFrameRing()
+{
+    Destroy();
+}
+
+void VulkanFrameRing::Create(const VkDevice device, const u32 queueFamily, const u32 frameCount)
+{
+    Destroy();
+    m_Device = device;
+    m_Frames.resize(std::max(frameCount, 1u));
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    for (u32 i = 0; i < m_Frames.size(); ++i)
+    {
+        VulkanFrame& frame = m_Frames[i];
+        frame.Index = i;
+        VK_CHECK(vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &frame.ImageAvailable));
+        VK_CHECK(vkCreateCommandPool(m_Device, &poolInfo, nullptr, &frame.CommandPool));
+
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = frame.CommandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(m_Device, &allocInfo, &frame.CommandBuffer));
+    }
+    CreateFences();
+}
+
+void VulkanFrameRing::Destroy()
+{
+    if (m_Device == VK_NULL_HANDLE)
+        return;
+
+    WaitIdle();
+    DestroyImageSemaphores();
+    DestroyFences();
+    for (const VulkanFrame& frame : m_Frames)
+    {
+        vkDestroyCommandPool(m_Device, frame.CommandPool, nullptr);
+        vkDestroySemaphore(m_Device, frame.ImageAvailable, nullptr);
+    }
+    m_Frames.clear();
+    m_Device         = VK_NULL_HANDLE;
+    m_FrameAllocator = nullptr;
+    m_Scheduler      = nullptr;
+    m_Current        = 0;
+    m_FrameNumber    = 0;
+}
+
+void VulkanFrameRing::SetScheduler(VulkanScheduler* scheduler, const VulkanQueueType queue)
+{
+    PL_ASSERT(!scheduler || scheduler->GetTimeline(queue), "Queue is not registered in the scheduler");
+
+    // 切换等待方式前旧方式记录的提交必须全部完成
+    WaitIdle();
+    const bool hadScheduler = m_Scheduler != nullptr;
+    m_Scheduler      = scheduler;
+    m_SchedulerQueue = queue;
+    for (VulkanFrame& frame : m_Frames)
+        frame.TimelineValue = 0;
+    m_ImageFences.assign(m_ImageFences.size(), VK_NULL_HANDLE);
+    m_ImageValues.assign(m_ImageValues.size(), 0);
+
+    if (m_Scheduler && !hadScheduler)
+        DestroyFences();
+    else if (!m_Scheduler && hadScheduler)
+        CreateFences();
+}
+
+void VulkanFrameRing::CreateFences()
+{
+    // 创建时就处于触发状态，第一次BeginFrame不会阻塞
+    VkFenceCreateInfo fenceInfo {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    for (VulkanFrame& frame : m_Frames)
+        VK_CHECK(vkCreateFence(m_Device, &fenceInfo, nullptr, &frame.InFlight));
+}
+
+void VulkanFrameRing::DestroyFences()
+{
+    for (VulkanFrame& frame : m_Frames)
+    {
+        if (frame.InFlight != VK_NULL_HANDLE)
+            vkDestroyFence(m_Device, frame.InFlight, nullptr);
+        frame.InFlight = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanFrameRing::SetImageCount(const u32 imageCount)
+{
+    WaitIdle();
+    DestroyImageSemaphores();
+    m_ImageFences.assign(imageCount, VK_NULL_HANDLE);
+    m_ImageValues.assign(imageCount, 0);
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    m_RenderFinished.resize(imageCount);
+    for (VkSemaphore& semaphore : m_RenderFinished)
+        VK_CHECK(vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &semaphore));
+}
+
+void VulkanFrameRing::DestroyImageSemaphores()
+{
+    for (const VkSemaphore semaphore : m_RenderFinished)
+        vkDestroySemaphore(m_Device, semaphore, nullptr);
+    m_RenderFinished.clear();
+    m_ImageFences.clear();
+    m_ImageValues.clear();
+    for (VulkanFrame& frame : m_Frames)
+        frame.RenderFinished = VK_NULL_HANDLE;
+}
+
+VulkanFrame& VulkanFrameRing::BeginFrame()
+{
+    PL_ASSERT(m_Device != VK_NULL_HANDLE, "Frame ring is not created");
+
+    VulkanFrame& frame = m_Frames[m_Current];
+    if (const VulkanTimeline* timeline = GetTimeline())
+        timeline->Wait(frame.TimelineValue);
+    else
+        VK_CHECK(vkWaitForFences(m_Device, 1, &frame.InFlight, VK_TRUE, UINT64_MAX));
+
+    // 等待结束后这一帧的命令缓冲区和帧分配器区域都不再被GPU使用
+    if (m_FrameAllocator)
+        m_FrameAllocator->BeginFrame(m_Current);
+
+    // 每帧一次，执行GPU已经用完的延迟销毁
+    if (m_Scheduler)
+        m_Scheduler->Collect();
+
+    VK_CHECK(vkResetCommandPool(m_Device, frame.CommandPool, 0));
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(frame.CommandBuffer, &beginInfo));
+    return frame;
+}
+
+void VulkanFrameRing::BindImage(const u32 imageIndex)
+{
+    PL_ASSERT(imageIndex < m_RenderFinished.size(), "SetImageCount must be called after the swapchain is created");
+
+    // 图像数多于帧数时，获取到的图像可能还在被另一帧渲染
+    VulkanFrame& frame = m_Frames[m_Current];
+    if (const VulkanTimeline* timeline = GetTimeline())
+    {
+        // 图像的值在Submit时更新
+        timeline->Wait(m_ImageValues[imageIndex]);
+    }
+    else
+    {
+        VkFence& imageFence = m_ImageFences[imageIndex];
+        if (imageFence != VK_NULL_HANDLE && imageFence != frame.InFlight)
+            VK_CHECK(vkWaitForFences(m_Device, 1, &imageFence, VK_TRUE, UINT64_MAX));
+        imageFence = frame.InFlight;
+    }
+
+    // 再次获取到这个图像说明上一次对它的呈现已经消耗了信号量
+    frame.ImageIndex     = imageIndex;
+    frame.RenderFinished = m_RenderFinished[imageIndex];
+}
+
+VkResult VulkanFrameRing::Submit(const VkQueue queue, const VkPipelineStageFlags waitStage)
+{
+    VulkanFrame& frame = m_Frames[m_Current];
+    PL_ASSERT(frame.RenderFinished != VK_NULL_HANDLE, "BindImage must be called before Submit");
+    VK_CHECK(vkEndCommandBuffer(frame.CommandBuffer));
+
+    if (m_FrameAllocator)
+        m_FrameAllocator->Flush();
+
+    // 通过时间线提交时不使用栅栏，帧和图像都记录这次提交的值
+    if (m_Scheduler)
+    {
+        PL_ASSERT(m_Scheduler->GetTimeline(m_SchedulerQueue)->GetQueue() == queue, "Frame submitted to a queue other than its timeline's");
+        VulkanSubmission submission;
+        submission.CommandBuffers   = Span<const VkCommandBuffer>(&frame.CommandBuffer, 1);
+        submission.BinaryWaits      = Span<const VkSemaphore>(&frame.ImageAvailable, 1);
+        submission.BinaryWaitStages = Span<const VkPipelineStageFlags>(&waitStage, 1);
+        submission.BinarySignals    = Span<const VkSemaphore>(&frame.RenderFinished, 1);
+        frame.TimelineValue = m_Scheduler->Submit(m_SchedulerQueue, submission);
+        m_ImageValues[frame.ImageIndex] = frame.TimelineValue;
+        return VK_SUCCESS;
+    }
+
+    VK_CHECK(vkResetFences(m_Device, 1, &frame.InFlight));
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount   = 1;
+    submitInfo.pWaitSemaphores      = &frame.ImageAvailable;
+    submitInfo.pWaitDstStageMask    = &waitStage;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &frame.CommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &frame.RenderFinished;
+    return vkQueueSubmit(queue, 1, &submitInfo, frame.InFlight);
+}
+
+void VulkanFrameRing::EndFrame()
+{
+    m_Frames[m_Current].RenderFinished = VK_NULL_HANDLE;
+    m_Current = (m_Current + 1) % static_cast<u32>(m_Frames.size());
+    ++m_FrameNumber;
+}
+
+void VulkanFrameRing::WaitIdle() const
+{
+    // 同一时间线上的值按提交顺序完成，等待最大的值即可
+    if (const VulkanTimeline* timeline = GetTimeline())
+    {
+        u64 value {0};
+        for (const VulkanFrame& frame : m_Frames)
+            value = std::max(value, frame.TimelineValue);
+        timeline->Wait(value);
+        return;
+    }
+
+    Vector<VkFence> fences;
+    fences.reserve(m_Frames.size());
+    for (const VulkanFrame& frame : m_Frames)
+        fences.push_back(frame.InFlight);
+    if (!fences.empty())
+        VK_CHECK(vkWaitForFences(m_Device, static_cast<u32>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX));
+}
@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include "Core/BaseType.h"
+#include "Vulkan.h"
+
+#include "VulkanScheduler.h"
+
+class VulkanFrameAllocator;
+
+/** @brief 一个飞行帧独占的同步对象和命令缓冲区 */
+struct VulkanFrame
+{
+    u32 Index {0};                                      ///< 在帧环中的位置
+    u32 ImageIndex {0};                                 ///< BindImage绑定的交换链图像
+    VkSemaphore ImageAvailable {VK_NULL_HANDLE};        ///< 交换链图像可用时触发
+    VkSemaphore RenderFinished {VK_NULL_HANDLE};        ///< 绑定图像的渲染完成信号量，本帧渲染命令执行完时触发，呈现前等待，属于图像而不是帧
+    VkFence InFlight {VK_NULL_HANDLE};                  ///< 本帧提交执行完时触发，设置了调度器时为空
+    u64 TimelineValue {0};                              ///< 设置了调度器时本帧最后一次提交的时间线值
+    VkCommandPool CommandPool {VK_NULL_HANDLE};         ///< 每帧重置的命令池
+    VkCommandBuffer CommandBuffer {VK_NULL_HANDLE};     ///< 本帧的主命令缓冲区
+};
+
+/**
+ * @class VulkanFrameRing
+ * @brief 飞行帧环
+ * @details
+ * 每帧有独立的信号量、栅栏和命令池，CPU录制第N帧时GPU可以继续执行前面的帧 \n
+ * BeginFrame只等待当前帧上一次提交的栅栏，然后重置命令池并开始录制 \n
+ * 交换链图像数和帧数可以不同，每个图像记录最后使用它的帧的栅栏或提交的时间线值，BindImage时等待仍在使用该图像的帧 \n
+ * 渲染完成信号量按交换链图像分配，帧的栅栏触发不能说明上一次呈现已经消耗了信号量， \n
+ * 只有再次获取到同一个图像时才能确定它的信号量可以复用 \n
+ * 不使用调度器时栅栏在Submit时才重置，获取图像失败提前返回时不会留下永远不会触发的栅栏 \n
+ * 设置了帧分配器时，BeginFrame在栅栏触发后重置该帧的区域，Submit前刷新写入的数据 \n
+ * 设置了调度器时，Submit通过队列的时间线提交，时间线值代替栅栏成为唯一的等待方式，帧和图像都记录提交的值， \n
+ * 每帧的栅栏被销毁，BeginFrame还会执行已经可以执行的延迟销毁 \n
+ * 每帧的用法:
+ * @code
+ * VulkanFrame& frame = ring.BeginFrame();
+ * swapChain.AcquireNextImage(&imageIndex, ring);  // 或者用frame.ImageAvailable获取后调用ring.BindImage
+ * // 向frame.CommandBuffer录制命令
+ * ring.Submit(queue);
+ * swapChain.PresentImage(imageIndex, ring);
+ * ring.EndFrame();
+ * @endcode
+ */
+class VulkanFrameRing
+{
+public:
+    VulkanFrameRing() = default;
+    ~VulkanFrameRing();
+
+    VulkanFrameRing(const VulkanFrameRing&) = delete;
+    VulkanFrameRing& operator=(const VulkanFrameRing&) = delete;
+
+    /** 创建frameCount个帧，命令池属于queueFamily */
+    void Create(VkDevice device, u32 queueFamily, u32 frameCount);
+
+    /** 等待所有帧完成并销毁 */
+    void Destroy();
+
+    /** 设置随帧重置的线性分配器，分配器的帧数需要和帧环一致 */
+    void SetFrameAllocator(VulkanFrameAllocator* allocator) { m_FrameAllocator = allocator; }
+
+    /** 设置提交调度器，帧提交到queue对应的时间线，queue需要已经注册；会等待所有帧完成，并按模式销毁或重建每帧的栅栏 */
+    void SetScheduler(VulkanScheduler* scheduler, VulkanQueueType queue = VulkanQueueType::Graphics);
+
+    /**
+     * @brief 创建交换链后调用，清空图像的栅栏记录并重建每个图像的渲染完成信号量
+     * @note 旧的信号量会被销毁，重建交换链时需要先等待设备空闲
+     */
+    void SetImageCount(u32 imageCount);
+
+    /** 等待当前帧可以复用，重置命令池并开始录制命令缓冲区 */
+    VulkanFrame& BeginFrame();
+
+    /** 获取到交换链图像后调用，等待之前仍在使用该图像的帧，并把该图像的渲染完成信号量绑定到当前帧 */
+    void BindImage(u32 imageIndex);
+
+    /** 结束录制并提交，等待ImageAvailable，触发RenderFinished和InFlight */
+    VkResult Submit(VkQueue queue, VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+    /** 前进到下一帧 */
+    void EndFrame();
+
+    /** 等待所有帧的提交完成 */
+    void WaitIdle() const;
+
+    VulkanFrame& GetCurrentFrame() { return m_Frames[m_Current]; }
+    u32 GetFrameCount() const { return static_cast<u32>(m_Frames.size()); }
+
+    /** 已经结束的帧数 */
+    u64 GetFrameNumber() const { return m_FrameNumber; }
+
+private:
+    // 销毁所有图像的渲染完成信号量
+    void DestroyImageSemaphores();
+
+    // 创建每帧的栅栏，创建时处于触发状态
+    void CreateFences();
+
+    // 销毁每帧的栅栏
+    void DestroyFences();
+
+    // 帧提交使用的时间线，没有设置调度器时为nullptr
+    VulkanTimeline* GetTimeline() const { return m_Scheduler ? m_Scheduler->GetTimeline(m_SchedulerQueue) : nullptr; }
+
+private:
+    VkDevice m_Device {VK_NULL_HANDLE};                 ///< 逻辑设备
+    Vector<VulkanFrame> m_Frames;                       ///< 所有飞行帧
+    Vector<VkFence> m_ImageFences;                      ///< 每个交换链图像最后一次被使用时所属帧的栅栏，没有设置调度器时使用
+    Vector<u64> m_ImageValues;                          ///< 每个交换链图像最后一次被使用的提交的时间线值，设置了调度器时使用
+    Vector<VkSemaphore> m_RenderFinished;               ///< 每个交换链图像的渲染完成信号量
+    VulkanFrameAllocator* m_FrameAllocator {nullptr};   ///< 随帧重置的线性分配器，可以为空
+    VulkanScheduler* m_Scheduler {nullptr};             ///< 提交调度器，可以为空
+    VulkanQueueType m_SchedulerQueue {VulkanQueueType::Graphics}; ///< 帧提交使用的时间线
+    u32 m_Current {0};                                  ///< 当前帧
+    u64 m_FrameNumber {0};                              ///< 已经结束的帧数
+};
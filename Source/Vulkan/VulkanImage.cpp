@@ -0,0 +1,161 @@
+﻿#include "VulkanImage.h"
+
+#include <stdexcept>
+
+VulkanImage::VulkanImage(const VulkanAllocator& allocator, const VulkanImageDesc& desc)
+    : m_Allocator(allocator.GetHandle()), m_Device(allocator.GetDevice()), m_Desc(desc)
+{
+    if (m_Desc.Aspect == 0)
+        m_Desc.Aspect = GetAspect(m_Desc.Format);
+
+    VkImageCreateInfo imageInfo {};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = m_Desc.Format;
+    imageInfo.extent        = {m_Desc.Extent.width, m_Desc.Extent.height, 1};
+    imageInfo.mipLevels     = m_Desc.MipLevels;
+    imageInfo.arrayLayers   = m_Desc.ArrayLayers;
+    imageInfo.samples       = m_Desc.Samples;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = m_Desc.Usage;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // 较大的附件单独分配，避免占满共享的内存块
+    VmaAllocationCreateInfo allocationInfo = VulkanAllocator::MakeAllocationCreateInfo(VulkanMemoryUsage::GpuOnly);
+    if (m_Desc.Usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        allocationInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+    if (vmaCreateImage(m_Allocator, &imageInfo, &allocationInfo, &m_Image, &m_Allocation, nullptr) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create image");
+
+    VkImageViewCreateInfo viewInfo {};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = m_Image;
+    viewInfo.viewType                        = m_Desc.ArrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = m_Desc.Format;
+    viewInfo.subresourceRange.aspectMask     = m_Desc.Aspect;
+    viewInfo.subresourceRange.baseMipLevel   = 0;
+    viewInfo.subresourceRange.levelCount     = m_Desc.MipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount     = m_Desc.ArrayLayers;
+    if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_View) != VK_SUCCESS)
+    {
+        Destroy();
+        throw std::runtime_error("Failed to create image view");
+    }
+}
+
+VulkanImage::~VulkanImage()
+{
+    Destroy();
+}
+
+VulkanImage::VulkanImage(VulkanImage&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+VulkanImage& VulkanImage::operator=(VulkanImage&& other) noexcept
+{
+    if (this != &other)
+    {
+        Destroy();
+        m_Allocator  = std::exchange(other.m_Allocator, VK_NULL_HANDLE);
+        m_Device     = std::exchange(other.m_Device, VK_NULL_HANDLE);
+        m_Image      = std::exchange(other.m_Image, VK_NULL_HANDLE);
+        m_View       = std::exchange(other.m_View, VK_NULL_HANDLE);
+        m_Allocation = std::exchange(other.m_Allocation, VK_NULL_HANDLE);
+        m_Desc       = other.m_Desc;
+    }
+    return *this;
+}
+
+void VulkanImage::Destroy()
+{
+    if (m_View != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(m_Device, m_View, nullptr);
+        m_View = VK_NULL_HANDLE;
+    }
+    if (m_Image != VK_NULL_HANDLE)
+    {
+        vmaDestroyImage(m_Allocator, m_Image, m_Allocation);
+        m_Image      = VK_NULL_HANDLE;
+        m_Allocation = VK_NULL_HANDLE;
+    }
+}
+
+VkImageAspectFlags VulkanImage::GetAspect(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+u32 VulkanImage::GetTexelSize(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SNORM:
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8_SINT:
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_S8_UINT:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SNORM:
+    case VK_FORMAT_R8G8_UINT:
+    case VK_FORMAT_R8G8_SINT:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R16_UNORM:
+    case VK_FORMAT_R16_SNORM:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_R16_SINT:
+    case VK_FORMAT_R16_SFLOAT:
+    case VK_FORMAT_D16_UNORM:
+        return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_UINT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_UINT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
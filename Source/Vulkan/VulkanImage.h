@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "Core/BaseType.h"
+#include "VulkanMemory.h"
+
+/** @brief 图像描述 */
+struct VulkanImageDesc
+{
+    VkExtent2D Extent {0, 0};                           ///< 宽高
+    VkFormat Format {VK_FORMAT_R8G8B8A8_UNORM};         ///< 格式
+    VkImageUsageFlags Usage {VK_IMAGE_USAGE_SAMPLED_BIT}; ///< 用途
+    u32 MipLevels {1};                                  ///< mip层数
+    u32 ArrayLayers {1};                                ///< 数组层数
+    VkSampleCountFlagBits Samples {VK_SAMPLE_COUNT_1_BIT}; ///< 采样数
+    VkImageAspectFlags Aspect {0};                      ///< 视图的aspect，为0时根据格式推断
+};
+
+/**
+ * @class VulkanImage
+ * @brief 从VulkanAllocator分配的二维图像及其视图
+ * @details
+ * 图像使用OPTIMAL布局，总是放在设备本地内存中，初始布局为UNDEFINED \n
+ * 只能移动不能拷贝，析构时释放视图、图像和内存，调用者需要保证GPU已经不再使用
+ */
+class VulkanImage
+{
+public:
+    VulkanImage() = default;
+    VulkanImage(const VulkanAllocator& allocator, const VulkanImageDesc& desc);
+    ~VulkanImage();
+
+    VulkanImage(const VulkanImage&) = delete;
+    VulkanImage& operator=(const VulkanImage&) = delete;
+    VulkanImage(VulkanImage&& other) noexcept;
+    VulkanImage& operator=(VulkanImage&& other) noexcept;
+
+    VkImage GetHandle() const { return m_Image; }
+    VkImageView GetView() const { return m_View; }
+    const VulkanImageDesc& GetDesc() const { return m_Desc; }
+
+    /** 释放图像 */
+    void Destroy();
+
+    /** 根据格式推断aspect */
+    static VkImageAspectFlags GetAspect(VkFormat format);
+
+    /** 获取非压缩格式每个像素的字节数，压缩格式和未列出的格式返回0 */
+    static u32 GetTexelSize(VkFormat format);
+
+private:
+    VmaAllocator m_Allocator {VK_NULL_HANDLE};      ///< 分配器
+    VkDevice m_Device {VK_NULL_HANDLE};             ///< 逻辑设备
+    VkImage m_Image {VK_NULL_HANDLE};               ///< 图像
+    VkImageView m_View {VK_NULL_HANDLE};            ///< 覆盖全部mip和层的视图
+    VmaAllocation m_Allocation {VK_NULL_HANDLE};    ///< 内存分配
+    VulkanImageDesc m_Desc;                         ///< 创建时的描述
+};
@@ -0,0 +1,72 @@
+﻿#define VMA_IMPLEMENTATION
+#include "VulkanMemory.h"
+
+#include "VulkanUtils.h"
+#include "Core/Log/Log.h"
+
+VulkanAllocator::~VulkanAllocator()
+{
+    Destroy();
+}
+
+void VulkanAllocator::Create(const VkInstance instance, const VkPhysicalDevice physicalDevice, const VkDevice device, const u32 apiVersion)
+{
+    Destroy();
+    m_Device = device;
+
+    VmaVulkanFunctions functions {};
+    functions.vkGetInstanceProcAddr = vkGetInstanceProcAddr;
+    functions.vkGetDeviceProcAddr   = vkGetDeviceProcAddr;
+
+    VmaAllocatorCreateInfo createInfo {};
+    createInfo.instance         = instance;
+    createInfo.physicalDevice   = physicalDevice;
+    createInfo.device           = device;
+    createInfo.vulkanApiVersion = apiVersion;
+    createInfo.pVulkanFunctions = &functions;
+    VK_CHECK(vmaCreateAllocator(&createInfo, &m_Allocator));
+}
+
+void VulkanAllocator::Destroy()
+{
+    if (m_Allocator == VK_NULL_HANDLE)
+        return;
+
+    vmaDestroyAllocator(m_Allocator);
+    m_Allocator = VK_NULL_HANDLE;
+    m_Device    = VK_NULL_HANDLE;
+}
+
+u32 VulkanAllocator::GetDeviceAllocationCount() const
+{
+    if (m_Allocator == VK_NULL_HANDLE)
+        return 0;
+
+    VmaTotalStatistics statistics;
+    vmaCalculateStatistics(m_Allocator, &statistics);
+    return statistics.total.statistics.blockCount;
+}
+
+VmaAllocationCreateInfo VulkanAllocator::MakeAllocationCreateInfo(const VulkanMemoryUsage usage)
+{
+    VmaAllocationCreateInfo createInfo {};
+    switch (usage)
+    {
+    case VulkanMemoryUsage::GpuOnly:
+        createInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        break;
+    case VulkanMemoryUsage::Upload:
+        createInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+        createInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        break;
+    case VulkanMemoryUsage::Dynamic:
+        createInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        createInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        break;
+    case VulkanMemoryUsage::Readback:
+        createInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+        createInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        break;
+    }
+    return createInfo;
+}
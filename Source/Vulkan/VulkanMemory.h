@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include "Core/BaseType.h"
+#include "Vulkan.h"
+
+// 函数指针统一从vkGetInstanceProcAddr/vkGetDeviceProcAddr获取，使用volk时同样可用
+#define VMA_STATIC_VULKAN_FUNCTIONS 0
+#define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
+#include "VulkanMemAlloc/VkMemAlloc.h"
+
+/**
+ * @brief 资源的内存用途
+ * @details 只描述CPU如何访问，具体的内存类型由VMA根据设备选择
+ */
+enum class VulkanMemoryUsage : u8
+{
+    GpuOnly,    ///< 只由GPU访问，优先设备本地内存，通过传输命令写入
+    Upload,     ///< CPU顺序写入、GPU读取，持久映射，用于暂存缓冲区
+    Dynamic,    ///< CPU每帧顺序写入、GPU直接读取，持久映射，支持时优先放在设备本地且可映射的内存中
+    Readback,   ///< GPU写入、CPU随机读取，持久映射
+};
+
+/**
+ * @class VulkanAllocator
+ * @brief 基于VulkanMemoryAllocator的设备内存分配器
+ * @details
+ * 所有缓冲区和图像都从这里分配，VMA在大块设备内存中子分配，避免每个资源一次vkAllocateMemory \n
+ * 需要在设备创建后创建，在销毁设备前销毁，销毁前所有资源都必须已经释放
+ */
+class VulkanAllocator
+{
+public:
+    VulkanAllocator() = default;
+    ~VulkanAllocator();
+
+    VulkanAllocator(const VulkanAllocator&) = delete;
+    VulkanAllocator& operator=(const VulkanAllocator&) = delete;
+
+    /** 创建分配器，apiVersion需要与创建实例时一致 */
+    void Create(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, u32 apiVersion = VK_API_VERSION_1_2);
+
+    /** 销毁分配器，存在未释放的资源时VMA会断言 */
+    void Destroy();
+
+    /** 获取VMA句柄，未创建时为VK_NULL_HANDLE */
+    VmaAllocator GetHandle() const { return m_Allocator; }
+
+    /** 获取逻辑设备 */
+    VkDevice GetDevice() const { return m_Device; }
+
+    /** 当前设备内存块数量，即实际调用vkAllocateMemory的次数 */
+    u32 GetDeviceAllocationCount() const;
+
+    /** 把内存用途转换为VMA的分配参数 */
+    static VmaAllocationCreateInfo MakeAllocationCreateInfo(VulkanMemoryUsage usage);
+
+private:
+    VmaAllocator m_Allocator {VK_NULL_HANDLE};  ///< VMA分配器
+    VkDevice m_Device {VK_NULL_HANDLE};         ///< 逻辑设备
+};
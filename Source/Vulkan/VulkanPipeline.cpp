@@ -0,0 +1,518 @@
+﻿#include "VulkanPipeline.h"
+
+#include <bit>
+
+#include "VulkanPipelineLog.h"
+#include "VulkanUtils.h"
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+namespace
+{
+    // 按字节哈希Vulkan的POD数组，这些结构体只包含32位字段，没有填充
+    template<typename T>
+    u64 HashArray(const u64 seed, const Vector<T>& values)
+    {
+        const u64 hash = Hash::Combine64(seed, values.size());
+        return values.empty() ? hash : Hash::Hash64(values.data(), values.size() * sizeof(T), hash);
+    }
+
+    template<typename T>
+    bool EqualArray(const Vector<T>& a, const Vector<T>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    // 着色器阶段按共享二进制比较，内容相同的阶段是同一个实例
+    bool EqualStages(const SharedPtr<const Shader>& a, const SharedPtr<const Shader>& b)
+    {
+        if (a == b)
+            return true;
+        if (!a || !b)
+            return false;
+        return a->GetStages() == b->GetStages();
+    }
+
+    // 颜色附件默认不混合并写入全部通道
+    VkPipelineColorBlendAttachmentState MakeDefaultBlend()
+    {
+        VkPipelineColorBlendAttachmentState blend {};
+        blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        blend.blendEnable    = VK_FALSE;
+        return blend;
+    }
+
+    // 管线布局只由描述符绑定和推送常量决定
+    u64 ComputeLayoutHash(const ShaderReflectionData& reflection)
+    {
+        u64 hash = Hash::Hash64(StringView("VulkanPipelineLayout"));
+        hash = Hash::Combine64(hash, reflection.Bindings.size());
+        for (const ShaderDescriptorBinding& binding : reflection.Bindings)
+        {
+            hash = Hash::Combine64(hash, binding.Set);
+            hash = Hash::Combine64(hash, binding.Binding);
+            hash = Hash::Combine64(hash, binding.Type);
+            hash = Hash::Combine64(hash, binding.Count);
+            hash = Hash::Combine64(hash, binding.StageFlags);
+        }
+        return HashArray(hash, reflection.PushConstants);
+    }
+}
+
+u64 VulkanPipelineDesc::Hash(const bool dynamicRasterState) const
+{
+    u64 hash = Hash::Hash64(StringView("VulkanPipelineDesc"));
+
+    if (Program)
+    {
+        hash = Hash::Combine64(hash, Program->GetStages().size());
+        for (const auto& [stage, blob] : Program->GetStages())
+        {
+            hash = Hash::Combine64(hash, static_cast<u64>(stage));
+            hash = Hash::Combine64(hash, blob->GetHash());
+        }
+    }
+
+    hash = HashArray(hash, VertexLayout.Bindings);
+    hash = HashArray(hash, VertexLayout.Attributes);
+    hash = Hash::Combine64(hash, Topology);
+
+    hash = Hash::Combine64(hash, Raster.PolygonMode);
+    hash = Hash::Combine64(hash, Raster.DepthClampEnable);
+    hash = Hash::Combine64(hash, Raster.DepthBiasEnable);
+    hash = Hash::Combine64(hash, std::bit_cast<u32>(Raster.LineWidth));
+
+    hash = Hash::Combine64(hash, dynamicRasterState);
+    if (!dynamicRasterState)
+    {
+        hash = Hash::Combine64(hash, Raster.CullMode);
+        hash = Hash::Combine64(hash, Raster.FrontFace);
+        hash = Hash::Combine64(hash, Depth.TestEnable);
+        hash = Hash::Combine64(hash, Depth.WriteEnable);
+        hash = Hash::Combine64(hash, Depth.CompareOp);
+    }
+
+    hash = HashArray(hash, Blend);
+
+    hash = HashArray(hash, RenderPass.ColorFormats);
+    hash = Hash::Combine64(hash, RenderPass.DepthFormat);
+    hash = Hash::Combine64(hash, RenderPass.Samples);
+    hash = Hash::Combine64(hash, RenderPass.Subpass);
+    return hash;
+}
+
+bool VulkanPipelineDesc::Equals(const VulkanPipelineDesc& other, const bool dynamicRasterState) const
+{
+    const bool rasterEqual = dynamicRasterState || (
+           Raster.CullMode == other.Raster.CullMode
+        && Raster.FrontFace == other.Raster.FrontFace
+        && Depth.TestEnable == other.Depth.TestEnable
+        && Depth.WriteEnable == other.Depth.WriteEnable
+        && Depth.CompareOp == other.Depth.CompareOp);
+
+    return rasterEqual
+        && EqualStages(Program, other.Program)
+        && EqualArray(VertexLayout.Bindings, other.VertexLayout.Bindings)
+        && EqualArray(VertexLayout.Attributes, other.VertexLayout.Attributes)
+        && Topology == other.Topology
+        && Raster.PolygonMode == other.Raster.PolygonMode
+        && Raster.DepthClampEnable == other.Raster.DepthClampEnable
+        && Raster.DepthBiasEnable == other.Raster.DepthBiasEnable
+        && Raster.LineWidth == other.Raster.LineWidth
+        && EqualArray(Blend, other.Blend)
+        && RenderPass.ColorFormats == other.RenderPass.ColorFormats
+        && RenderPass.DepthFormat == other.RenderPass.DepthFormat
+        && RenderPass.Samples == other.RenderPass.Samples
+        && RenderPass.Subpass == other.RenderPass.Subpass;
+}
+
+bool VulkanPipeline::Wait() const
+{
+    m_Status.wait(VulkanPipelineStatus::Pending, std::memory_order_acquire);
+    return IsReady();
+}
+
+void VulkanPipeline::Resolve(const VkPipeline pipeline)
+{
+    m_Pipeline.store(pipeline, std::memory_order_release);
+    m_Status.store(pipeline != VK_NULL_HANDLE ? VulkanPipelineStatus::Ready : VulkanPipelineStatus::Failed, std::memory_order_release);
+    m_Status.notify_all();
+}
+
+VulkanPipelineRegistry::~VulkanPipelineRegistry()
+{
+    Destroy();
+}
+
+void VulkanPipelineRegistry::Create(const VkDevice device, const VkPipelineCache pipelineCache, const bool extendedDynamicState, u32 workerCount)
+{
+    Destroy();
+    m_Device        = device;
+    m_PipelineCache = pipelineCache;
+
+    m_ExtendedDynamicState = false;
+    if (extendedDynamicState)
+    {
+        m_CmdSetCullMode         = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetCullModeEXT"));
+        m_CmdSetFrontFace        = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetFrontFaceEXT"));
+        m_CmdSetDepthTestEnable  = reinterpret_cast<PFN_vkCmdSetDepthTestEnableEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthTestEnableEXT"));
+        m_CmdSetDepthWriteEnable = reinterpret_cast<PFN_vkCmdSetDepthWriteEnableEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthWriteEnableEXT"));
+        m_CmdSetDepthCompareOp   = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthCompareOpEXT"));
+        m_ExtendedDynamicState   = m_CmdSetCullMode && m_CmdSetFrontFace && m_CmdSetDepthTestEnable && m_CmdSetDepthWriteEnable && m_CmdSetDepthCompareOp;
+        if (!m_ExtendedDynamicState)
+            Log::CatWarn("Vulkan", "{0}", "Extended dynamic state functions are missing, cull and depth state stay baked into pipelines");
+    }
+
+    // 留一半核心给渲染线程和着色器编译
+    if (workerCount == 0)
+        workerCount = std::max(std::thread::hardware_concurrency() / 2, 1u);
+    m_Workers = MakeUnique<ThreadPool>(workerCount);
+}
+
+void VulkanPipelineRegistry::Destroy()
+{
+    // 线程池析构时会执行完剩余的任务，任务内部需要加锁，所以不能持有锁
+    m_Workers.reset();
+
+    std::lock_guard lock(m_Mutex);
+    if (m_Device == VK_NULL_HANDLE)
+        return;
+
+    for (auto& [hash, pipelines] : m_Pipelines)
+    {
+        for (const SharedPtr<VulkanPipeline>& pipeline : pipelines)
+        {
+            if (pipeline->GetHandle() != VK_NULL_HANDLE)
+                vkDestroyPipeline(m_Device, pipeline->GetHandle(), nullptr);
+        }
+    }
+    m_Pipelines.clear();
+
+    for (auto& [hash, entry] : m_Layouts)
+    {
+        vkDestroyPipelineLayout(m_Device, entry.Layout, nullptr);
+        for (const VkDescriptorSetLayout setLayout : entry.SetLayouts)
+        {
+            vkDestroyDescriptorSetLayout(m_Device, setLayout, nullptr);
+        }
+    }
+    m_Layouts.clear();
+
+    m_Device        = VK_NULL_HANDLE;
+    m_PipelineCache = VK_NULL_HANDLE;
+}
+
+const VulkanPipeline* VulkanPipelineRegistry::GetOrCreate(const VulkanPipelineDesc& desc)
+{
+    bool created {false};
+    const SharedPtr<VulkanPipeline> pipeline = Acquire(desc, created);
+    if (!pipeline)
+        return nullptr;
+
+    if (created)
+        Compile(*pipeline);
+    return pipeline->Wait() ? pipeline.get() : nullptr;
+}
+
+const VulkanPipeline* VulkanPipelineRegistry::GetOrCreateAsync(const VulkanPipelineDesc& desc)
+{
+    bool created {false};
+    SharedPtr<VulkanPipeline> pipeline = Acquire(desc, created);
+    if (!pipeline)
+        return nullptr;
+
+    // 任务持有引用，编译期间被Remove也不会释放
+    if (created)
+        m_Workers->Submit([this, pipeline] { Compile(*pipeline); });
+    return pipeline->GetStatus() != VulkanPipelineStatus::Failed ? pipeline.get() : nullptr;
+}
+
+const VulkanPipeline* VulkanPipelineRegistry::Find(const VulkanPipelineDesc& desc) const
+{
+    const u64 hash = desc.Hash(m_ExtendedDynamicState);
+    std::lock_guard lock(m_Mutex);
+    return FindLocked(desc, hash).get();
+}
+
+bool VulkanPipelineRegistry::Remove(const VulkanPipelineDesc& desc)
+{
+    const u64 hash = desc.Hash(m_ExtendedDynamicState);
+    SharedPtr<VulkanPipeline> removed;
+    {
+        std::lock_guard lock(m_Mutex);
+        const auto it = m_Pipelines.find(hash);
+        if (it == m_Pipelines.end())
+            return false;
+
+        auto& pipelines = it->second;
+        const auto pipeline = std::ranges::find_if(pipelines, [&](const SharedPtr<VulkanPipeline>& p) { return p->GetDesc().Equals(desc, m_ExtendedDynamicState); });
+        if (pipeline == pipelines.end())
+            return false;
+
+        removed = std::move(*pipeline);
+        pipelines.erase(pipeline);
+        if (pipelines.empty())
+            m_Pipelines.erase(it);
+    }
+
+    // 正在编译的管线等编译结束后再销毁
+    if (removed->Wait())
+        vkDestroyPipeline(m_Device, removed->GetHandle(), nullptr);
+    return true;
+}
+
+size_t VulkanPipelineRegistry::GetPipelineCount() const
+{
+    std::lock_guard lock(m_Mutex);
+    size_t count {0};
+    for (const auto& [hash, pipelines] : m_Pipelines)
+    {
+        count += pipelines.size();
+    }
+    return count;
+}
+
+void VulkanPipelineRegistry::SetDynamicState(const VkCommandBuffer commandBuffer, const VulkanPipelineDesc& desc, const VkExtent2D extent) const
+{
+    VkViewport viewport {};
+    viewport.width    = static_cast<f32>(extent.width);
+    viewport.height   = static_cast<f32>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor {};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    if (!m_ExtendedDynamicState)
+        return;
+
+    m_CmdSetCullMode(commandBuffer, desc.Raster.CullMode);
+    m_CmdSetFrontFace(commandBuffer, desc.Raster.FrontFace);
+    if (desc.RenderPass.DepthFormat != VK_FORMAT_UNDEFINED)
+    {
+        m_CmdSetDepthTestEnable(commandBuffer, desc.Depth.TestEnable ? VK_TRUE : VK_FALSE);
+        m_CmdSetDepthWriteEnable(commandBuffer, desc.Depth.WriteEnable ? VK_TRUE : VK_FALSE);
+        m_CmdSetDepthCompareOp(commandBuffer, desc.Depth.CompareOp);
+    }
+}
+
+SharedPtr<VulkanPipeline> VulkanPipelineRegistry::FindLocked(const VulkanPipelineDesc& desc, const u64 hash) const
+{
+    const auto it = m_Pipelines.find(hash);
+    if (it == m_Pipelines.end())
+        return nullptr;
+
+    for (const SharedPtr<VulkanPipeline>& pipeline : it->second)
+    {
+        if (pipeline->GetDesc().Equals(desc, m_ExtendedDynamicState))
+            return pipeline;
+    }
+    return nullptr;
+}
+
+SharedPtr<VulkanPipeline> VulkanPipelineRegistry::Acquire(const VulkanPipelineDesc& desc, bool& outCreated)
+{
+    PL_ASSERT(m_Device != VK_NULL_HANDLE, "Pipeline registry is not created");
+    outCreated = false;
+    if (!desc.Program)
+    {
+        Log::CatError("Vulkan", "{0}", "Pipeline description has no shader");
+        return nullptr;
+    }
+
+    const u64 hash = desc.Hash(m_ExtendedDynamicState);
+    std::lock_guard lock(m_Mutex);
+    if (SharedPtr<VulkanPipeline> existing = FindLocked(desc, hash))
+    {
+        // 失败的管线不再缓存失败结果，由这次请求重新编译
+        if (existing->GetStatus() == VulkanPipelineStatus::Failed)
+        {
+            existing->Retry();
+            outCreated = true;
+        }
+        return existing;
+    }
+
+    const VkPipelineLayout layout = GetLayoutLocked(*desc.Program);
+    if (layout == VK_NULL_HANDLE)
+        return nullptr;
+
+    if (m_Log)
+        m_Log->Record(desc);
+
+    outCreated = true;
+    return m_Pipelines[hash].emplace_back(MakeShared<VulkanPipeline>(desc, hash, layout));
+}
+
+void VulkanPipelineRegistry::Compile(VulkanPipeline& pipeline) const
+{
+    const TimePoint start = Now();
+    const VkPipeline handle = CreatePipeline(pipeline.GetDesc(), pipeline.GetLayout());
+    if (handle == VK_NULL_HANDLE)
+        Log::CatError("Vulkan", "Failed to create pipeline for shader '{0}'", pipeline.GetDesc().Program->GetName());
+    else
+        Log::CatInfo("Vulkan", "Created pipeline {0} for shader '{1}' in {2:.2f} ms", Hash::ToHexString(pipeline.GetHash()), pipeline.GetDesc().Program->GetName(), Elapsed(start, Now()).count() * 1000.0);
+    pipeline.Resolve(handle);
+}
+
+VkPipelineLayout VulkanPipelineRegistry::GetLayoutLocked(const Shader& shader)
+{
+    const ShaderReflectionData& reflection = shader.GetReflection();
+    const u64 hash = ComputeLayoutHash(reflection);
+    if (const auto it = m_Layouts.find(hash); it != m_Layouts.end())
+        return it->second.Layout;
+
+    LayoutEntry entry;
+
+    // 描述符集必须连续，中间缺失的集使用空布局
+    const Map<u32, Vector<VkDescriptorSetLayoutBinding>> sets = ShaderReflection::MakeDescriptorSetLayoutBindings(reflection);
+    const u32 setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+    for (u32 set = 0; set < setCount; ++set)
+    {
+        const auto it = sets.find(set);
+
+        VkDescriptorSetLayoutCreateInfo setInfo {};
+        setInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        setInfo.bindingCount = it == sets.end() ? 0 : static_cast<u32>(it->second.size());
+        setInfo.pBindings    = it == sets.end() ? nullptr : it->second.data();
+
+        VkDescriptorSetLayout setLayout {VK_NULL_HANDLE};
+        if (vkCreateDescriptorSetLayout(m_Device, &setInfo, nullptr, &setLayout) != VK_SUCCESS)
+        {
+            Log::CatError("Vulkan", "Failed to create descriptor set layout {0} for shader '{1}'", set, shader.GetName());
+            for (const VkDescriptorSetLayout created : entry.SetLayouts)
+            {
+                vkDestroyDescriptorSetLayout(m_Device, created, nullptr);
+            }
+            return VK_NULL_HANDLE;
+        }
+        entry.SetLayouts.push_back(setLayout);
+    }
+
+    VkPipelineLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount         = static_cast<u32>(entry.SetLayouts.size());
+    layoutInfo.pSetLayouts            = entry.SetLayouts.data();
+    layoutInfo.pushConstantRangeCount = static_cast<u32>(reflection.PushConstants.size());
+    layoutInfo.pPushConstantRanges    = reflection.PushConstants.data();
+
+    if (vkCreatePipelineLayout(m_Device, &layoutInfo, nullptr, &entry.Layout) != VK_SUCCESS)
+    {
+        Log::CatError("Vulkan", "Failed to create pipeline layout for shader '{0}'", shader.GetName());
+        for (const VkDescriptorSetLayout created : entry.SetLayouts)
+        {
+            vkDestroyDescriptorSetLayout(m_Device, created, nullptr);
+        }
+        return VK_NULL_HANDLE;
+    }
+
+    return m_Layouts.emplace(hash, std::move(entry)).first->second.Layout;
+}
+
+VkPipeline VulkanPipelineRegistry::CreatePipeline(const VulkanPipelineDesc& desc, const VkPipelineLayout layout) const
+{
+    Vector<VkPipelineShaderStageCreateInfo> stages;
+    for (const auto& [stage, blob] : desc.Program->GetStages())
+    {
+        VkPipelineShaderStageCreateInfo stageInfo {};
+        stageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfo.stage  = Utils::Shader::ShaderStageToVulkan(stage);
+        stageInfo.module = blob->GetModule(m_Device);
+        stageInfo.pName  = "main";
+        if (stageInfo.module == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+        stages.push_back(stageInfo);
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInput {};
+    vertexInput.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount   = static_cast<u32>(desc.VertexLayout.Bindings.size());
+    vertexInput.pVertexBindingDescriptions      = desc.VertexLayout.Bindings.data();
+    vertexInput.vertexAttributeDescriptionCount = static_cast<u32>(desc.VertexLayout.Attributes.size());
+    vertexInput.pVertexAttributeDescriptions    = desc.VertexLayout.Attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
+    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology               = desc.Topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // 视口和裁剪矩形由SetDynamicState设置
+    VkPipelineViewportStateCreateInfo viewportState {};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount  = 1;
+
+    Vector<VkDynamicState> dynamicStates {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    if (m_ExtendedDynamicState)
+    {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+        if (desc.RenderPass.DepthFormat != VK_FORMAT_UNDEFINED)
+        {
+            dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+            dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+            dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+        }
+    }
+
+    VkPipelineDynamicStateCreateInfo dynamicState {};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<u32>(dynamicStates.size());
+    dynamicState.pDynamicStates    = dynamicStates.data();
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {};
+    rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable        = desc.Raster.DepthClampEnable ? VK_TRUE : VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode             = desc.Raster.PolygonMode;
+    rasterizer.lineWidth               = desc.Raster.LineWidth;
+    rasterizer.cullMode                = desc.Raster.CullMode;
+    rasterizer.frontFace               = desc.Raster.FrontFace;
+    rasterizer.depthBiasEnable         = desc.Raster.DepthBiasEnable ? VK_TRUE : VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling {};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable  = VK_FALSE;
+    multisampling.rasterizationSamples = desc.RenderPass.Samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil {};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = desc.Depth.TestEnable ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = desc.Depth.WriteEnable ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp   = desc.Depth.CompareOp;
+
+    Vector<VkPipelineColorBlendAttachmentState> blend = desc.Blend;
+    if (blend.empty())
+        blend.assign(desc.RenderPass.ColorFormats.size(), MakeDefaultBlend());
+    PL_ASSERT(blend.size() == desc.RenderPass.ColorFormats.size(), "Blend state count does not match color attachments");
+
+    VkPipelineColorBlendStateCreateInfo colorBlending {};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable   = VK_FALSE;
+    colorBlending.attachmentCount = static_cast<u32>(blend.size());
+    colorBlending.pAttachments    = blend.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo {};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = static_cast<u32>(stages.size());
+    pipelineInfo.pStages             = stages.data();
+    pipelineInfo.pVertexInputState   = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = desc.RenderPass.DepthFormat == VK_FORMAT_UNDEFINED ? nullptr : &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = layout;
+    pipelineInfo.renderPass          = desc.RenderPass.Handle;
+    pipelineInfo.subpass             = desc.RenderPass.Subpass;
+    pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
+
+    VkPipeline pipeline {VK_NULL_HANDLE};
+    if (vkCreateGraphicsPipelines(m_Device, m_PipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return pipeline;
+}
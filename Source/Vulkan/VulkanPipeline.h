@@ -0,0 +1,229 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "Core/BaseType.h"
+#include "Core/ThreadPool.h"
+#include "Shader/VulkanShader.h"
+#include "Vulkan.h"
+
+class VulkanPipelineLog;
+
+/** @brief 顶点输入布局 */
+struct VulkanVertexLayout
+{
+    Vector<VkVertexInputBindingDescription> Bindings;       ///< 顶点缓冲区绑定
+    Vector<VkVertexInputAttributeDescription> Attributes;   ///< 顶点属性
+};
+
+/** @brief 光栅化状态 */
+struct VulkanRasterState
+{
+    VkPolygonMode PolygonMode {VK_POLYGON_MODE_FILL};       ///< 填充模式
+    VkCullModeFlags CullMode {VK_CULL_MODE_BACK_BIT};       ///< 剔除模式
+    VkFrontFace FrontFace {VK_FRONT_FACE_CLOCKWISE};        ///< 正面朝向
+    bool DepthClampEnable {false};                          ///< 深度钳制
+    bool DepthBiasEnable {false};                           ///< 深度偏移
+    f32 LineWidth {1.0f};                                   ///< 线宽
+};
+
+/** @brief 深度模板状态 */
+struct VulkanDepthState
+{
+    bool TestEnable {false};                                ///< 深度测试
+    bool WriteEnable {false};                               ///< 深度写入
+    VkCompareOp CompareOp {VK_COMPARE_OP_LESS_OR_EQUAL};    ///< 比较函数
+};
+
+/**
+ * @brief 渲染通道兼容性
+ * @details
+ * 按Vulkan的兼容规则只比较附件格式、采样数和子通道，兼容的渲染通道共享同一个管线 \n
+ * Handle只用于创建管线，不参与哈希和比较
+ */
+struct VulkanRenderPassLayout
+{
+    VkRenderPass Handle {VK_NULL_HANDLE};                   ///< 用于创建管线的渲染通道
+    Vector<VkFormat> ColorFormats;                          ///< 颜色附件格式
+    VkFormat DepthFormat {VK_FORMAT_UNDEFINED};             ///< 深度附件格式，没有深度附件时为UNDEFINED
+    VkSampleCountFlagBits Samples {VK_SAMPLE_COUNT_1_BIT};  ///< 采样数
+    u32 Subpass {0};                                        ///< 子通道索引
+};
+
+/**
+ * @brief 图形管线描述
+ * @details
+ * 描述创建一个图形管线所需的全部状态，管线布局由shader反射数据生成 \n
+ * 着色器按阶段二进制的内容哈希参与哈希，其余状态逐字段参与哈希，结果在不同运行间保持稳定 \n
+ * 视口和裁剪矩形始终是动态状态，不在描述中，窗口大小改变时不需要重建管线
+ */
+struct VulkanPipelineDesc
+{
+    SharedPtr<const Shader> Program;                        ///< 着色器
+    VulkanVertexLayout VertexLayout;                        ///< 顶点输入布局
+    VkPrimitiveTopology Topology {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST}; ///< 图元拓扑
+    VulkanRasterState Raster;                               ///< 光栅化状态
+    VulkanDepthState Depth;                                 ///< 深度模板状态
+    Vector<VkPipelineColorBlendAttachmentState> Blend;      ///< 颜色混合，为空时所有颜色附件不混合并写入全部通道
+    VulkanRenderPassLayout RenderPass;                      ///< 渲染通道兼容性
+
+    /** 计算描述的64位哈希，dynamicRasterState为true时剔除、正面朝向和深度状态由命令缓冲区设置，不参与哈希 */
+    u64 Hash(bool dynamicRasterState = false) const;
+
+    /** 比较描述，dynamicRasterState的含义与Hash相同 */
+    bool Equals(const VulkanPipelineDesc& other, bool dynamicRasterState = false) const;
+
+    bool operator==(const VulkanPipelineDesc& other) const { return Equals(other); }
+};
+
+/** @brief 管线编译状态 */
+enum class VulkanPipelineStatus : u8
+{
+    Pending,    ///< 正在编译
+    Ready,      ///< 可以使用
+    Failed,     ///< 编译失败，再次请求时重新编译
+};
+
+/**
+ * @class VulkanPipeline
+ * @brief 由VulkanPipelineRegistry创建并持有的图形管线
+ * @details 异步请求时先返回处于Pending状态的管线，编译完成前GetHandle返回VK_NULL_HANDLE，绘制时应跳过或使用备用管线
+ */
+class VulkanPipeline
+{
+public:
+    VulkanPipeline(VulkanPipelineDesc desc, u64 hash, VkPipelineLayout layout)
+        : m_Desc(std::move(desc)), m_Hash(hash), m_Layout(layout) {}
+
+    VulkanPipeline(const VulkanPipeline&) = delete;
+    VulkanPipeline& operator=(const VulkanPipeline&) = delete;
+
+    const VulkanPipelineDesc& GetDesc() const { return m_Desc; }
+    u64 GetHash() const { return m_Hash; }
+
+    /** 管线句柄，编译完成前为VK_NULL_HANDLE */
+    VkPipeline GetHandle() const { return m_Pipeline.load(std::memory_order_acquire); }
+
+    /** 管线布局，由注册表按布局内容共享，调用者不要销毁 */
+    VkPipelineLayout GetLayout() const { return m_Layout; }
+
+    VulkanPipelineStatus GetStatus() const { return m_Status.load(std::memory_order_acquire); }
+    bool IsReady() const { return GetStatus() == VulkanPipelineStatus::Ready; }
+
+    /** 阻塞直到编译结束，返回是否可用 */
+    bool Wait() const;
+
+private:
+    friend class VulkanPipelineRegistry;
+
+    // 编译结束时由注册表调用，pipeline为VK_NULL_HANDLE表示失败
+    void Resolve(VkPipeline pipeline);
+
+    // 失败的管线重新进入Pending状态，由注册表在持有锁时调用
+    void Retry() { m_Status.store(VulkanPipelineStatus::Pending, std::memory_order_release); }
+
+private:
+    VulkanPipelineDesc m_Desc;                      ///< 创建时的描述
+    u64 m_Hash {0};                                 ///< 描述哈希
+    VkPipelineLayout m_Layout {VK_NULL_HANDLE};     ///< 共享的管线布局
+    std::atomic<VkPipeline> m_Pipeline {VK_NULL_HANDLE};                    ///< 管线
+    std::atomic<VulkanPipelineStatus> m_Status {VulkanPipelineStatus::Pending}; ///< 编译状态
+};
+
+/**
+ * @class VulkanPipelineRegistry
+ * @brief 图形管线注册表
+ * @details
+ * 以描述哈希为键，相等的描述只创建一次管线，之后直接返回已有的管线 \n
+ * 管线布局按反射出的描述符集和推送常量去重，多个管线共享同一个布局 \n
+ * GetOrCreateAsync把编译交给工作线程，立即返回Pending状态的管线，渲染线程不会因为新管线卡顿 \n
+ * 驱动保证VkPipelineCache内部同步，所有工作线程共用同一个管线缓存 \n
+ * 开启扩展动态状态后，只有剔除和深度状态不同的描述共享同一个管线，录制时由SetDynamicState设置 \n
+ * 管线在Remove或Destroy前一直有效，调用者需要保证GPU不再使用后再移除 \n
+ * 编译失败的管线同样保留到Remove，期间再次请求时在同一个对象上重新编译，已返回的指针仍然有效 \n
+ * 所有接口线程安全
+ */
+class VulkanPipelineRegistry
+{
+public:
+    VulkanPipelineRegistry() = default;
+    ~VulkanPipelineRegistry();
+
+    VulkanPipelineRegistry(const VulkanPipelineRegistry&) = delete;
+    VulkanPipelineRegistry& operator=(const VulkanPipelineRegistry&) = delete;
+
+    /**
+     * @brief 设置设备和管线缓存
+     * @param pipelineCache 可以为VK_NULL_HANDLE
+     * @param extendedDynamicState 设备是否启用了VK_EXT_extended_dynamic_state
+     * @param workerCount 异步编译的线程数，为0时按CPU核数决定
+     */
+    void Create(VkDevice device, VkPipelineCache pipelineCache, bool extendedDynamicState = false, u32 workerCount = 0);
+
+    /** 等待所有异步编译结束，然后销毁所有管线和布局，需要在销毁设备前调用 */
+    void Destroy();
+
+    /** 获取与desc相等的管线，不存在时在当前线程创建，正在异步编译时等待其完成，失败时返回nullptr */
+    const VulkanPipeline* GetOrCreate(const VulkanPipelineDesc& desc);
+
+    /** 获取与desc相等的管线，不存在时提交到工作线程编译并立即返回，失败时返回nullptr */
+    const VulkanPipeline* GetOrCreateAsync(const VulkanPipelineDesc& desc);
+
+    /** 查找已创建的管线，不会创建 */
+    const VulkanPipeline* Find(const VulkanPipelineDesc& desc) const;
+
+    /** 销毁与desc相等的管线，正在编译时先等待，布局保留 */
+    bool Remove(const VulkanPipelineDesc& desc);
+
+    /** 当前持有的管线数量 */
+    size_t GetPipelineCount() const;
+
+    /** 是否开启了扩展动态状态 */
+    bool HasExtendedDynamicState() const { return m_ExtendedDynamicState; }
+
+    /** 录制动态状态：视口和裁剪矩形覆盖extent，开启扩展动态状态时同时设置desc中的剔除和深度状态 */
+    void SetDynamicState(VkCommandBuffer commandBuffer, const VulkanPipelineDesc& desc, VkExtent2D extent) const;
+
+    /** 设置预热日志，之后每个新描述都会被记录，需要在请求管线前设置，log为nullptr时停止记录 */
+    void SetLog(VulkanPipelineLog* log) { m_Log = log; }
+
+private:
+    // 在已加锁的前提下查找
+    SharedPtr<VulkanPipeline> FindLocked(const VulkanPipelineDesc& desc, u64 hash) const;
+
+    // 查找或登记一个Pending状态的管线，outCreated表示是否为新登记的
+    SharedPtr<VulkanPipeline> Acquire(const VulkanPipelineDesc& desc, bool& outCreated);
+
+    // 编译管线并更新状态
+    void Compile(VulkanPipeline& pipeline) const;
+
+    // 获取或创建shader对应的管线布局，需要持有锁
+    VkPipelineLayout GetLayoutLocked(const Shader& shader);
+
+    // 创建管线，失败时返回VK_NULL_HANDLE
+    VkPipeline CreatePipeline(const VulkanPipelineDesc& desc, VkPipelineLayout layout) const;
+
+private:
+    // 共享的管线布局和它的描述符集布局
+    struct LayoutEntry
+    {
+        VkPipelineLayout Layout {VK_NULL_HANDLE};
+        Vector<VkDescriptorSetLayout> SetLayouts;
+    };
+
+    VkDevice m_Device {VK_NULL_HANDLE};                     ///< 逻辑设备
+    VkPipelineCache m_PipelineCache {VK_NULL_HANDLE};       ///< 管线缓存
+    UMap<u64, Vector<SharedPtr<VulkanPipeline>>> m_Pipelines; ///< 描述哈希 -> 管线，哈希冲突时同一个键下有多个
+    UMap<u64, LayoutEntry> m_Layouts;                       ///< 布局哈希 -> 布局
+    mutable std::mutex m_Mutex;                             ///< 保护以上容器
+    UniquePtr<ThreadPool> m_Workers;                        ///< 异步编译的工作线程
+    VulkanPipelineLog* m_Log {nullptr};                     ///< 预热日志，可以为空
+
+    bool m_ExtendedDynamicState {false};                    ///< 剔除和深度状态是否为动态状态
+    PFN_vkCmdSetCullModeEXT m_CmdSetCullMode {nullptr};
+    PFN_vkCmdSetFrontFaceEXT m_CmdSetFrontFace {nullptr};
+    PFN_vkCmdSetDepthTestEnableEXT m_CmdSetDepthTestEnable {nullptr};
+    PFN_vkCmdSetDepthWriteEnableEXT m_CmdSetDepthWriteEnable {nullptr};
+    PFN_vkCmdSetDepthCompareOpEXT m_CmdSetDepthCompareOp {nullptr};
+};
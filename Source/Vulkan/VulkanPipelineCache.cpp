@@ -0,0 +1,147 @@
+﻿#include "VulkanPipelineCache.h"
+
+#include <fstream>
+
+#include "VulkanUtils.h"
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+    Destroy();
+}
+
+void VulkanPipelineCache::Create(const VkPhysicalDevice physicalDevice, const VkDevice device, const File::Path& path)
+{
+    Destroy();
+    m_Device = device;
+    m_Path   = path;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    Vector<u8> initialData;
+    if (Load(properties, initialData))
+    {
+        m_SavedHash = Hash::Hash64(initialData.data(), initialData.size());
+        Log::CatInfo("Vulkan", "Loaded pipeline cache '{0}' ({1} bytes)", m_Path.string(), initialData.size());
+    }
+
+    VkPipelineCacheCreateInfo createInfo {};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData    = initialData.empty() ? nullptr : initialData.data();
+    if (vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_Cache) == VK_SUCCESS)
+        return;
+
+    // 驱动拒绝了初始数据，退回到空缓存
+    Log::CatWarn("Vulkan", "Driver rejected pipeline cache '{0}', starting empty", m_Path.string());
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData    = nullptr;
+    m_SavedHash = 0;
+    VK_CHECK(vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_Cache));
+}
+
+bool VulkanPipelineCache::Save()
+{
+    if (m_Cache == VK_NULL_HANDLE)
+        return false;
+
+    size_t dataSize {0};
+    if (vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        return false;
+
+    Vector<u8> data(dataSize);
+    if (vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, data.data()) != VK_SUCCESS)
+        return false;
+    data.resize(dataSize);
+
+    FileHeader header;
+    header.Magic    = Magic;
+    header.Version  = Version;
+    header.DataSize = data.size();
+    header.DataHash = Hash::Hash64(data.data(), data.size());
+    if (header.DataHash == m_SavedHash)
+        return true;
+
+    std::error_code error;
+    if (!m_Path.parent_path().empty())
+        std::filesystem::create_directories(m_Path.parent_path(), error);
+
+    File::Path tempPath = m_Path;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out.flush())
+        {
+            Log::CatError("Vulkan", "Could not write pipeline cache '{0}'", tempPath.string());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, m_Path, error);
+    if (error)
+    {
+        Log::CatError("Vulkan", "Could not replace pipeline cache '{0}': {1}", m_Path.string(), error.message());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    m_SavedHash = header.DataHash;
+    Log::CatInfo("Vulkan", "Saved pipeline cache '{0}' ({1} bytes)", m_Path.string(), data.size());
+    return true;
+}
+
+void VulkanPipelineCache::Destroy()
+{
+    if (m_Cache == VK_NULL_HANDLE)
+        return;
+
+    Save();
+    vkDestroyPipelineCache(m_Device, m_Cache, nullptr);
+    m_Cache     = VK_NULL_HANDLE;
+    m_Device    = VK_NULL_HANDLE;
+    m_SavedHash = 0;
+}
+
+bool VulkanPipelineCache::Load(const VkPhysicalDeviceProperties& properties, Vector<u8>& outData) const
+{
+    const File::MappedFile file(m_Path);
+    if (!file.IsOpen() || file.GetSize() < sizeof(FileHeader))
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    const Span<const u8> data = file.GetSpan().subspan(sizeof(header));
+    if (header.Magic != Magic || header.Version != Version || header.DataSize != data.size() ||
+        Hash::Hash64(data.data(), data.size()) != header.DataHash)
+    {
+        Log::CatWarn("Vulkan", "Pipeline cache '{0}' is corrupted, starting empty", m_Path.string());
+        return false;
+    }
+
+    if (!IsCompatible(data, properties))
+    {
+        Log::CatInfo("Vulkan", "Pipeline cache '{0}' belongs to another device or driver, starting empty", m_Path.string());
+        return false;
+    }
+
+    outData.assign(data.begin(), data.end());
+    return true;
+}
+
+bool VulkanPipelineCache::IsCompatible(const Span<const u8> data, const VkPhysicalDeviceProperties& properties)
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header)
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
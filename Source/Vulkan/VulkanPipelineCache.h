@@ -0,0 +1,62 @@
+﻿#pragma once
+#include "Core/BaseType.h"
+#include "Core/FileSystem.h"
+#include "Vulkan.h"
+
+/**
+ * @class VulkanPipelineCache
+ * @brief 持久化的Vulkan管线缓存
+ * @details
+ * 创建时读取磁盘上的缓存数据，只有完整性校验通过且VkPipelineCacheHeaderVersionOne中的
+ * 厂商ID、设备ID和UUID都与当前设备一致时才交给驱动，否则从空缓存开始 \n
+ * 所有管线创建都应传入GetHandle()，销毁时把驱动数据写回磁盘，先写临时文件再替换，数据没有变化时不写
+ */
+class VulkanPipelineCache
+{
+public:
+    static constexpr u32 Magic   = 0x43504C50; // "PLPC"
+    static constexpr u32 Version = 1;
+
+    VulkanPipelineCache() = default;
+    ~VulkanPipelineCache();
+
+    VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+    VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+    /** 创建管线缓存，path处的数据与当前设备匹配时作为初始数据 */
+    void Create(VkPhysicalDevice physicalDevice, VkDevice device, const File::Path& path = GetDefaultPath());
+
+    /** 把驱动数据写回磁盘，数据没有变化时直接返回true */
+    bool Save();
+
+    /** 保存并销毁，需要在销毁设备前调用 */
+    void Destroy();
+
+    /** 获取管线缓存句柄，未创建时为VK_NULL_HANDLE */
+    VkPipelineCache GetHandle() const { return m_Cache; }
+
+    /** 默认缓存路径，位于项目缓存根目录下 */
+    static File::Path GetDefaultPath() { return GetProjectCacheDir() / "vulkan/pipeline.cache"; }
+
+private:
+    // 文件头，之后紧跟驱动返回的缓存数据
+    struct FileHeader
+    {
+        u32 Magic {0};          ///< 魔数
+        u32 Version {0};        ///< 文件格式版本
+        u64 DataSize {0};       ///< 驱动数据字节数
+        u64 DataHash {0};       ///< 驱动数据哈希
+    };
+
+    // 读取缓存文件，数据不完整或与设备不匹配时返回false
+    bool Load(const VkPhysicalDeviceProperties& properties, Vector<u8>& outData) const;
+
+    // 驱动数据头是否与当前设备匹配
+    static bool IsCompatible(Span<const u8> data, const VkPhysicalDeviceProperties& properties);
+
+private:
+    VkDevice m_Device {VK_NULL_HANDLE};         ///< 逻辑设备
+    VkPipelineCache m_Cache {VK_NULL_HANDLE};   ///< 管线缓存
+    File::Path m_Path;                          ///< 缓存文件路径
+    u64 m_SavedHash {0};                        ///< 磁盘上数据的哈希，用于跳过没有变化的写入
+};
@@ -0,0 +1,304 @@
+﻿#include "VulkanPipelineLog.h"
+
+#include <fstream>
+
+#include "Core/Hash.h"
+#include "Core/Log/Log.h"
+
+namespace
+{
+    class LogWriter
+    {
+    public:
+        template<typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const u8* bytes = reinterpret_cast<const u8*>(&value);
+            m_Data.insert(m_Data.end(), bytes, bytes + sizeof(T));
+        }
+
+        void Write(const String& value)
+        {
+            Write(static_cast<u32>(value.size()));
+            m_Data.insert(m_Data.end(), value.begin(), value.end());
+        }
+
+        template<typename T>
+        void Write(const Vector<T>& values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Write(static_cast<u32>(values.size()));
+            const u8* bytes = reinterpret_cast<const u8*>(values.data());
+            m_Data.insert(m_Data.end(), bytes, bytes + values.size() * sizeof(T));
+        }
+
+        Vector<u8>& GetData() { return m_Data; }
+
+    private:
+        Vector<u8> m_Data;
+    };
+
+    class LogReader
+    {
+    public:
+        explicit LogReader(const Span<const u8> data) : m_Data(data) {}
+
+        template<typename T>
+        bool Read(T& outValue)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (m_Data.size() - m_Offset < sizeof(T))
+                return false;
+            std::memcpy(&outValue, m_Data.data() + m_Offset, sizeof(T));
+            m_Offset += sizeof(T);
+            return true;
+        }
+
+        bool Read(String& outValue)
+        {
+            u32 size {0};
+            if (!Read(size) || m_Data.size() - m_Offset < size)
+                return false;
+            outValue.assign(reinterpret_cast<const char*>(m_Data.data() + m_Offset), size);
+            m_Offset += size;
+            return true;
+        }
+
+        template<typename T>
+        bool Read(Vector<T>& outValues)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            u32 count {0};
+            if (!Read(count) || (m_Data.size() - m_Offset) / sizeof(T) < count)
+                return false;
+            outValues.resize(count);
+            std::memcpy(outValues.data(), m_Data.data() + m_Offset, count * sizeof(T));
+            m_Offset += count * sizeof(T);
+            return true;
+        }
+
+        bool IsEnd() const { return m_Offset == m_Data.size(); }
+
+    private:
+        Span<const u8> m_Data;
+        size_t m_Offset {0};
+    };
+}
+
+void VulkanPipelineLog::Open(const File::Path& path)
+{
+    std::lock_guard lock(m_Mutex);
+    m_Path = path;
+    m_Records.clear();
+    m_Hashes.clear();
+    m_Dirty = false;
+
+    const File::MappedFile file(m_Path);
+    if (!file.IsOpen() || file.GetSize() < sizeof(FileHeader))
+        return;
+
+    FileHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    const Span<const u8> data = file.GetSpan().subspan(sizeof(header));
+    if (header.Magic != Magic || header.Version != Version || header.DataSize != data.size() ||
+        Hash::Hash64(data.data(), data.size()) != header.DataHash ||
+        !Deserialize(data, header.RecordCount, m_Records))
+    {
+        Log::CatWarn("Vulkan", "Pipeline log '{0}' is corrupted or outdated, starting empty", m_Path.string());
+        m_Records.clear();
+        return;
+    }
+
+    for (const VulkanPipelineRecord& record : m_Records)
+    {
+        m_Hashes.insert(record.Hash);
+    }
+    Log::CatInfo("Vulkan", "Loaded pipeline log '{0}' ({1} pipelines)", m_Path.string(), m_Records.size());
+}
+
+void VulkanPipelineLog::Record(const VulkanPipelineDesc& desc)
+{
+    if (!desc.Program)
+        return;
+
+    const u64 hash = desc.Hash();
+    std::lock_guard lock(m_Mutex);
+    if (!m_Hashes.insert(hash).second)
+        return;
+
+    VulkanPipelineRecord& record = m_Records.emplace_back();
+    record.Hash                  = hash;
+    record.ShaderName            = desc.Program->GetName();
+    record.ShaderPath            = desc.Program->GetPath().generic_string();
+    record.Variant               = desc.Program->GetVariant();
+    record.Desc                  = desc;
+    record.Desc.Program          = nullptr;
+    record.Desc.RenderPass.Handle = VK_NULL_HANDLE;
+    m_Dirty = true;
+}
+
+size_t VulkanPipelineLog::Prewarm(VulkanPipelineRegistry& registry, const Resolver& resolver)
+{
+    // 解析时可能加载着色器，不持有锁
+    Vector<VulkanPipelineRecord> records;
+    {
+        std::lock_guard lock(m_Mutex);
+        records = m_Records;
+    }
+
+    Set<u64> staleHashes;
+    size_t submitted {0};
+    for (const VulkanPipelineRecord& record : records)
+    {
+        VulkanPipelineDesc desc = record.Desc;
+        if (!resolver(record, desc) || !desc.Program || desc.Hash() != record.Hash)
+        {
+            staleHashes.insert(record.Hash);
+            continue;
+        }
+
+        if (registry.GetOrCreateAsync(desc))
+            ++submitted;
+    }
+
+    if (!staleHashes.empty())
+    {
+        std::lock_guard lock(m_Mutex);
+        std::erase_if(m_Records, [&](const VulkanPipelineRecord& record) { return staleHashes.contains(record.Hash); });
+        for (const u64 hash : staleHashes)
+        {
+            m_Hashes.erase(hash);
+        }
+        m_Dirty = true;
+    }
+
+    Log::CatInfo("Vulkan", "Prewarming {0} pipelines, dropped {1} stale records", submitted, staleHashes.size());
+    return submitted;
+}
+
+bool VulkanPipelineLog::Save()
+{
+    std::lock_guard lock(m_Mutex);
+    if (!m_Dirty || m_Path.empty())
+        return true;
+
+    const Vector<u8> data = Serialize(m_Records);
+
+    FileHeader header;
+    header.Magic       = Magic;
+    header.Version     = Version;
+    header.RecordCount = m_Records.size();
+    header.DataSize    = data.size();
+    header.DataHash    = Hash::Hash64(data.data(), data.size());
+
+    std::error_code error;
+    if (!m_Path.parent_path().empty())
+        std::filesystem::create_directories(m_Path.parent_path(), error);
+
+    File::Path tempPath = m_Path;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out.flush())
+        {
+            Log::CatError("Vulkan", "Could not write pipeline log '{0}'", tempPath.string());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, m_Path, error);
+    if (error)
+    {
+        Log::CatError("Vulkan", "Could not replace pipeline log '{0}': {1}", m_Path.string(), error.message());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    m_Dirty = false;
+    Log::CatInfo("Vulkan", "Saved pipeline log '{0}' ({1} pipelines)", m_Path.string(), m_Records.size());
+    return true;
+}
+
+size_t VulkanPipelineLog::GetRecordCount() const
+{
+    std::lock_guard lock(m_Mutex);
+    return m_Records.size();
+}
+
+Vector<u8> VulkanPipelineLog::Serialize(const Vector<VulkanPipelineRecord>& records)
+{
+    LogWriter writer;
+    for (const VulkanPipelineRecord& record : records)
+    {
+        const VulkanPipelineDesc& desc = record.Desc;
+        writer.Write(record.Hash);
+        writer.Write(record.ShaderName);
+        writer.Write(record.ShaderPath);
+
+        writer.Write(static_cast<u32>(record.Variant.GetMacros().size()));
+        for (const ShaderMacro& macro : record.Variant.GetMacros())
+        {
+            writer.Write(macro.Name);
+            writer.Write(macro.Value);
+        }
+
+        writer.Write(desc.VertexLayout.Bindings);
+        writer.Write(desc.VertexLayout.Attributes);
+        writer.Write(desc.Topology);
+        writer.Write(desc.Raster.PolygonMode);
+        writer.Write(desc.Raster.CullMode);
+        writer.Write(desc.Raster.FrontFace);
+        writer.Write(static_cast<u8>(desc.Raster.DepthClampEnable));
+        writer.Write(static_cast<u8>(desc.Raster.DepthBiasEnable));
+        writer.Write(desc.Raster.LineWidth);
+        writer.Write(static_cast<u8>(desc.Depth.TestEnable));
+        writer.Write(static_cast<u8>(desc.Depth.WriteEnable));
+        writer.Write(desc.Depth.CompareOp);
+        writer.Write(desc.Blend);
+        writer.Write(desc.RenderPass.ColorFormats);
+        writer.Write(desc.RenderPass.DepthFormat);
+        writer.Write(desc.RenderPass.Samples);
+        writer.Write(desc.RenderPass.Subpass);
+    }
+    return std::move(writer.GetData());
+}
+
+bool VulkanPipelineLog::Deserialize(const Span<const u8> data, const u64 count, Vector<VulkanPipelineRecord>& outRecords)
+{
+    LogReader reader(data);
+    for (u64 i = 0; i < count; ++i)
+    {
+        VulkanPipelineRecord& record = outRecords.emplace_back();
+        VulkanPipelineDesc& desc = record.Desc;
+        u32 macroCount {0};
+        if (!reader.Read(record.Hash) || !reader.Read(record.ShaderName) || !reader.Read(record.ShaderPath) || !reader.Read(macroCount))
+            return false;
+
+        for (u32 m = 0; m < macroCount; ++m)
+        {
+            ShaderMacro macro;
+            if (!reader.Read(macro.Name) || !reader.Read(macro.Value))
+                return false;
+            record.Variant.Define(macro.Name, macro.Value);
+        }
+
+        u8 depthClamp {0}, depthBias {0}, depthTest {0}, depthWrite {0};
+        if (!reader.Read(desc.VertexLayout.Bindings) || !reader.Read(desc.VertexLayout.Attributes) ||
+            !reader.Read(desc.Topology) ||
+            !reader.Read(desc.Raster.PolygonMode) || !reader.Read(desc.Raster.CullMode) || !reader.Read(desc.Raster.FrontFace) ||
+            !reader.Read(depthClamp) || !reader.Read(depthBias) || !reader.Read(desc.Raster.LineWidth) ||
+            !reader.Read(depthTest) || !reader.Read(depthWrite) || !reader.Read(desc.Depth.CompareOp) ||
+            !reader.Read(desc.Blend) || !reader.Read(desc.RenderPass.ColorFormats) ||
+            !reader.Read(desc.RenderPass.DepthFormat) || !reader.Read(desc.RenderPass.Samples) || !reader.Read(desc.RenderPass.Subpass))
+            return false;
+
+        desc.Raster.DepthClampEnable = depthClamp != 0;
+        desc.Raster.DepthBiasEnable  = depthBias != 0;
+        desc.Depth.TestEnable        = depthTest != 0;
+        desc.Depth.WriteEnable       = depthWrite != 0;
+    }
+    return reader.IsEnd();
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <mutex>
+
+#include "Core/BaseType.h"
+#include "Core/FileSystem.h"
+#include "VulkanPipeline.h"
+
+/**
+ * @brief 管线日志中的一条记录
+ * @details Desc中的着色器和渲染通道句柄无法持久化，分别以着色器名称、路径、变体和渲染通道兼容性代替
+ */
+struct VulkanPipelineRecord
+{
+    u64 Hash {0};                   ///< 记录时描述的哈希，重建的描述哈希不一致说明着色器已经改变
+    String ShaderName;              ///< 着色器名称
+    String ShaderPath;              ///< 着色器源文件路径
+    ShaderVariantKey Variant;       ///< 着色器变体
+    VulkanPipelineDesc Desc;        ///< 描述，Program和RenderPass.Handle为空
+};
+
+/**
+ * @class VulkanPipelineLog
+ * @brief 管线预热日志
+ * @details
+ * 注册表每创建一个新描述的管线就追加一条记录，退出时写入磁盘 \n
+ * 下次启动时Prewarm把所有记录提交到注册表的工作线程编译，第一帧需要管线时通常已经编译完成 \n
+ * 文件损坏或版本不匹配时丢弃全部记录，着色器已经改变的记录在预热时跳过，并且不会写回 \n
+ * 所有接口线程安全
+ */
+class VulkanPipelineLog
+{
+public:
+    static constexpr u32 Magic   = 0x4C504C50; // "PLPL"
+    static constexpr u32 Version = 2;
+
+    /**
+     * @brief 由记录补全描述
+     * @details 需要设置desc.Program和desc.RenderPass.Handle，无法补全时返回false，该记录被跳过
+     */
+    using Resolver = Function<bool(const VulkanPipelineRecord& record, VulkanPipelineDesc& desc)>;
+
+    VulkanPipelineLog() = default;
+    ~VulkanPipelineLog() = default;
+
+    VulkanPipelineLog(const VulkanPipelineLog&) = delete;
+    VulkanPipelineLog& operator=(const VulkanPipelineLog&) = delete;
+
+    /** 读取path处的记录，文件不存在时从空日志开始 */
+    void Open(const File::Path& path = GetDefaultPath());
+
+    /** 记录一个描述，相同哈希的描述只记录一次 */
+    void Record(const VulkanPipelineDesc& desc);
+
+    /** 把记录提交到注册表异步编译，返回提交的数量 */
+    size_t Prewarm(VulkanPipelineRegistry& registry, const Resolver& resolver);
+
+    /** 写入磁盘，记录没有变化时直接返回true */
+    bool Save();
+
+    /** 当前记录数量 */
+    size_t GetRecordCount() const;
+
+    /** 默认日志路径，位于项目缓存根目录下 */
+    static File::Path GetDefaultPath() { return GetProjectCacheDir() / "vulkan/pipeline.log"; }
+
+private:
+    // 文件头，之后紧跟序列化的记录
+    struct FileHeader
+    {
+        u32 Magic {0};          ///< 魔数
+        u32 Version {0};        ///< 文件格式版本
+        u64 RecordCount {0};    ///< 记录数量
+        u64 DataSize {0};       ///< 记录数据字节数
+        u64 DataHash {0};       ///< 记录数据哈希
+    };
+
+    // 序列化全部记录
+    static Vector<u8> Serialize(const Vector<VulkanPipelineRecord>& records);
+
+    // 读取全部记录，格式错误时返回false
+    static bool Deserialize(Span<const u8> data, u64 count, Vector<VulkanPipelineRecord>& outRecords);
+
+private:
+    File::Path m_Path;                          ///< 日志文件路径
+    Vector<VulkanPipelineRecord> m_Records;     ///< 按记录顺序保存，预热时按相同顺序提交
+    Set<u64> m_Hashes;                          ///< 已记录的描述哈希
+    bool m_Dirty {false};                       ///< 是否有未写入的记录
+    mutable std::mutex m_Mutex;                 ///< 保护以上数据
+};
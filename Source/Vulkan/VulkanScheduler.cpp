@@ -0,0 +1,261 @@
+﻿#include "VulkanScheduler.h"
+
+#include "VulkanUtils.h"
+
+VulkanTimeline::~VulkanTimeline()
+{
+    Destroy();
+}
+
+void VulkanTimeline::Create(const VkDevice device, const VkQueue queue)
+{
+    Destroy();
+    m_Device = device;
+    m_Queue  = queue;
+    m_Submitted.store(0, std::memory_order_relaxed);
+    m_Completed.store(0, std::memory_order_relaxed);
+
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    VK_CHECK(vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Semaphore));
+}
+
+void VulkanTimeline::Destroy()
+{
+    if (m_Device == VK_NULL_HANDLE)
+        return;
+
+    WaitIdle();
+    vkDestroySemaphore(m_Device, m_Semaphore, nullptr);
+    m_Semaphore = VK_NULL_HANDLE;
+    m_Queue     = VK_NULL_HANDLE;
+    m_Device    = VK_NULL_HANDLE;
+}
+
+u64 VulkanTimeline::Submit(const VulkanSubmission& submission)
+{
+    PL_ASSERT(m_Semaphore != VK_NULL_HANDLE, "Timeline is not created");
+    PL_ASSERT(submission.BinaryWaits.size() == submission.BinaryWaitStages.size(), "Every binary wait needs a stage");
+
+    // 时间线和二进制信号量放在同一个数组中，二进制信号量对应的值会被忽略
+    Vector<VkSemaphore> waitSemaphores(submission.BinaryWaits.begin(), submission.BinaryWaits.end());
+    Vector<VkPipelineStageFlags> waitStages(submission.BinaryWaitStages.begin(), submission.BinaryWaitStages.end());
+    Vector<u64> waitValues(waitSemaphores.size(), 0);
+    for (const VulkanTimelineWait& wait : submission.TimelineWaits)
+    {
+        waitSemaphores.push_back(wait.Timeline->GetSemaphore());
+        waitStages.push_back(wait.Stage);
+        waitValues.push_back(wait.Value);
+    }
+
+    Vector<VkSemaphore> signalSemaphores(submission.BinarySignals.begin(), submission.BinarySignals.end());
+    Vector<u64> signalValues(signalSemaphores.size(), 0);
+    signalSemaphores.push_back(m_Semaphore);
+
+    std::lock_guard lock(m_SubmitMutex);
+    const u64 value = m_Submitted.load(std::memory_order_relaxed) + 1;
+    signalValues.push_back(value);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<u32>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<u32>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues    = signalValues.data();
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.waitSemaphoreCount   = static_cast<u32>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores      = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = waitStages.data();
+    submitInfo.commandBufferCount   = static_cast<u32>(submission.CommandBuffers.size());
+    submitInfo.pCommandBuffers      = submission.CommandBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<u32>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores    = signalSemaphores.data();
+    VK_CHECK(vkQueueSubmit(m_Queue, 1, &submitInfo, submission.Fence));
+
+    m_Submitted.store(value, std::memory_order_release);
+    return value;
+}
+
+u64 VulkanTimeline::Submit(const Span<const VkCommandBuffer> commandBuffers)
+{
+    VulkanSubmission submission;
+    submission.CommandBuffers = commandBuffers;
+    return Submit(submission);
+}
+
+u64 VulkanTimeline::GetCompletedValue() const
+{
+    u64 value {0};
+    VK_CHECK(vkGetSemaphoreCounterValue(m_Device, m_Semaphore, &value));
+
+    // 其他线程可能已经查询到更大的值
+    u64 cached = m_Completed.load(std::memory_order_relaxed);
+    while (cached < value && !m_Completed.compare_exchange_weak(cached, value, std::memory_order_relaxed))
+    {
+    }
+    return std::max(cached, value);
+}
+
+bool VulkanTimeline::IsComplete(const u64 value) const
+{
+    if (value <= m_Completed.load(std::memory_order_relaxed))
+        return true;
+    return value <= GetCompletedValue();
+}
+
+bool VulkanTimeline::Wait(const u64 value, const u64 timeout) const
+{
+    if (IsComplete(value))
+        return true;
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &m_Semaphore;
+    waitInfo.pValues        = &value;
+    const VkResult result = vkWaitSemaphores(m_Device, &waitInfo, timeout);
+    if (result == VK_TIMEOUT)
+        return false;
+    VK_CHECK(result);
+
+    u64 cached = m_Completed.load(std::memory_order_relaxed);
+    while (cached < value && !m_Completed.compare_exchange_weak(cached, value, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+
+VulkanScheduler::~VulkanScheduler()
+{
+    Destroy();
+}
+
+void VulkanScheduler::Create(const VkDevice device)
+{
+    Destroy();
+    m_Device = device;
+}
+
+void VulkanScheduler::Destroy()
+{
+    if (m_Device == VK_NULL_HANDLE)
+        return;
+
+    WaitIdle();
+    for (UniquePtr<VulkanTimeline>& timeline : m_Timelines)
+    {
+        timeline.reset();
+    }
+    m_Device = VK_NULL_HANDLE;
+}
+
+VulkanTimeline& VulkanScheduler::AddQueue(const VulkanQueueType type, const VkQueue queue)
+{
+    PL_ASSERT(m_Device != VK_NULL_HANDLE, "Scheduler is not created");
+    UniquePtr<VulkanTimeline>& timeline = m_Timelines[static_cast<u32>(type)];
+    PL_ASSERT(!timeline, "Queue is already registered");
+
+    timeline = MakeUnique<VulkanTimeline>();
+    timeline->Create(m_Device, queue);
+    return *timeline;
+}
+
+u64 VulkanScheduler::Submit(const VulkanQueueType type, const VulkanSubmission& submission)
+{
+    VulkanTimeline* timeline = GetTimeline(type);
+    PL_ASSERT(timeline, "Queue is not registered");
+    return timeline->Submit(submission);
+}
+
+void VulkanScheduler::Defer(Function<void()> destroy, const u8 queues)
+{
+    Deferred deferred;
+    for (u32 i = 0; i < QueueCount; ++i)
+    {
+        if (!m_Timelines[i])
+            continue;
+
+        // 引用资源的队列上正在录制的命令缓冲区要等到下一次提交完成；其他队列只等已经提交的工作，空闲时不会阻塞回收
+        const u64 submitted = m_Timelines[i]->GetSubmittedValue();
+        deferred.Values[i] = queues & BIT(i) ? submitted + 1 : submitted;
+    }
+    deferred.Destroy = std::move(destroy);
+
+    std::lock_guard lock(m_DeferredMutex);
+    m_Deferred.push_back(std::move(deferred));
+}
+
+void VulkanScheduler::Collect()
+{
+    // 不同的登记等待不同的队列，前面的未完成不代表后面的也未完成，需要检查全部
+    Vector<Function<void()>> ready;
+    {
+        std::lock_guard lock(m_DeferredMutex);
+        for (auto it = m_Deferred.begin(); it != m_Deferred.end();)
+        {
+            if (!IsComplete(*it))
+            {
+                ++it;
+                continue;
+            }
+            ready.push_back(std::move(it->Destroy));
+            it = m_Deferred.erase(it);
+        }
+    }
+
+    // 在锁外执行，销毁操作中可以再次登记
+    for (Function<void()>& destroy : ready)
+    {
+        destroy();
+    }
+}
+
+void VulkanScheduler::WaitIdle()
+{
+    for (const UniquePtr<VulkanTimeline>& timeline : m_Timelines)
+    {
+        if (timeline)
+            timeline->WaitIdle();
+    }
+
+    // 队列已经空闲，登记的值不会再被触发也可以执行，销毁操作可能登记新的延迟销毁，直到清空为止
+    while (true)
+    {
+        Deque<Deferred> deferred;
+        {
+            std::lock_guard lock(m_DeferredMutex);
+            deferred.swap(m_Deferred);
+        }
+        if (deferred.empty())
+            break;
+        for (Deferred& item : deferred)
+        {
+            item.Destroy();
+        }
+    }
+}
+
+size_t VulkanScheduler::GetDeferredCount() const
+{
+    std::lock_guard lock(m_DeferredMutex);
+    return m_Deferred.size();
+}
+
+bool VulkanScheduler::IsComplete(const Deferred& deferred) const
+{
+    for (u32 i = 0; i < QueueCount; ++i)
+    {
+        if (m_Timelines[i] && !m_Timelines[i]->IsComplete(deferred.Values[i]))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,182 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "Core/BaseType.h"
+#include "Vulkan.h"
+
+/** @brief 调度器管理的队列 */
+enum class VulkanQueueType : u8
+{
+    Graphics,
+    Compute,
+    Transfer,
+    Count
+};
+
+/** @brief 队列掩码，每个VulkanQueueType一位 */
+namespace VulkanQueueFlags
+{
+    enum VulkanQueueFlags : u8
+    {
+        None     = 0,
+        Graphics = BIT(0),
+        Compute  = BIT(1),
+        Transfer = BIT(2),
+        All      = Graphics | Compute | Transfer,
+    };
+}
+
+class VulkanTimeline;
+
+/** @brief 等待另一条时间线上的某个值 */
+struct VulkanTimelineWait
+{
+    const VulkanTimeline* Timeline {nullptr};
+    u64 Value {0};
+    VkPipelineStageFlags Stage {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+};
+
+/** @brief 一次提交的内容，二进制信号量只用于和交换链同步 */
+struct VulkanSubmission
+{
+    Span<const VkCommandBuffer> CommandBuffers;
+    Span<const VulkanTimelineWait> TimelineWaits;
+    Span<const VkSemaphore> BinaryWaits;
+    Span<const VkPipelineStageFlags> BinaryWaitStages;  ///< 与BinaryWaits一一对应
+    Span<const VkSemaphore> BinarySignals;
+    VkFence Fence {VK_NULL_HANDLE};                     ///< 需要和旧接口配合时使用，一般为空
+};
+
+/**
+ * @class VulkanTimeline
+ * @brief 一个队列上的时间线信号量
+ * @details
+ * 每次Submit把值加一并在提交完成时触发，返回的值可以在CPU上等待或查询，也可以被其他队列的提交等待 \n
+ * 同一队列上的提交按值的顺序完成，值小于等于已完成值的提交都已经执行完 \n
+ * Submit内部持有锁，保证值的顺序和vkQueueSubmit的顺序一致
+ */
+class VulkanTimeline
+{
+public:
+    VulkanTimeline() = default;
+    ~VulkanTimeline();
+
+    VulkanTimeline(const VulkanTimeline&) = delete;
+    VulkanTimeline& operator=(const VulkanTimeline&) = delete;
+
+    void Create(VkDevice device, VkQueue queue);
+
+    /** 等待所有提交完成并销毁信号量 */
+    void Destroy();
+
+    /** 提交并返回完成时触发的值 */
+    u64 Submit(const VulkanSubmission& submission);
+
+    /** 提交命令缓冲区并返回完成时触发的值 */
+    u64 Submit(Span<const VkCommandBuffer> commandBuffers);
+
+    /** 已经完成的最大值 */
+    u64 GetCompletedValue() const;
+
+    /** 最后一次提交的值 */
+    u64 GetSubmittedValue() const { return m_Submitted.load(std::memory_order_acquire); }
+
+    /** value对应的提交是否已经完成 */
+    bool IsComplete(u64 value) const;
+
+    /** 等待value对应的提交完成，超时返回false */
+    bool Wait(u64 value, u64 timeout = UINT64_MAX) const;
+
+    /** 等待所有已经提交的工作完成 */
+    void WaitIdle() const { Wait(GetSubmittedValue()); }
+
+    VkSemaphore GetSemaphore() const { return m_Semaphore; }
+    VkQueue GetQueue() const { return m_Queue; }
+
+private:
+    VkDevice m_Device {VK_NULL_HANDLE};             ///< 逻辑设备
+    VkQueue m_Queue {VK_NULL_HANDLE};               ///< 提交队列
+    VkSemaphore m_Semaphore {VK_NULL_HANDLE};       ///< 时间线信号量
+    std::atomic<u64> m_Submitted {0};               ///< 最后一次提交的值
+    mutable std::atomic<u64> m_Completed {0};       ///< 最近一次查询到的完成值，避免重复查询
+    std::mutex m_SubmitMutex;                       ///< 保证值的分配和提交顺序一致
+};
+
+/**
+ * @class VulkanScheduler
+ * @brief 基于时间线信号量的提交调度器
+ * @details
+ * 每个队列一条时间线，所有提交都带一个单调递增的值，CPU只需要等待或查询这个值，不需要为每次提交创建栅栏 \n
+ * Defer登记的销毁操作对引用资源的队列记录下一次提交将触发的值，已经录制但还没提交的命令缓冲区也被覆盖， \n
+ * 其他队列只记录已经提交的值，这些值全部完成后由Collect执行，设置了调度器的VulkanFrameRing在每帧开始时调用Collect \n
+ * 引用资源的队列在下一次提交前不会到达登记的值，queues只应包含实际使用该资源的队列 \n
+ * 需要设备开启timelineSemaphore功能
+ */
+class VulkanScheduler
+{
+public:
+    static constexpr u32 QueueCount = static_cast<u32>(VulkanQueueType::Count);
+
+    VulkanScheduler() = default;
+    ~VulkanScheduler();
+
+    VulkanScheduler(const VulkanScheduler&) = delete;
+    VulkanScheduler& operator=(const VulkanScheduler&) = delete;
+
+    void Create(VkDevice device);
+
+    /** 等待所有队列完成，执行所有延迟销毁并销毁时间线 */
+    void Destroy();
+
+    /** 为队列创建时间线，同一个VkQueue只能注册一次 */
+    VulkanTimeline& AddQueue(VulkanQueueType type, VkQueue queue);
+
+    /** 获取队列的时间线，未注册时返回nullptr */
+    VulkanTimeline* GetTimeline(VulkanQueueType type) { return m_Timelines[static_cast<u32>(type)].get(); }
+
+    /** 提交到队列并返回完成时触发的值 */
+    u64 Submit(VulkanQueueType type, const VulkanSubmission& submission);
+
+    /**
+     * @brief 在queues中每个队列的下一次提交、其他队列已有的提交都完成后执行destroy
+     * @param queues 引用资源的队列，见VulkanQueueFlags，这些队列上已经录制但还没提交的命令缓冲区可以引用资源
+     */
+    void Defer(Function<void()> destroy, u8 queues = VulkanQueueFlags::Graphics);
+
+    /** 延迟释放资源，时机与Defer相同 */
+    template<typename T>
+    void Release(T&& resource, const u8 queues = VulkanQueueFlags::Graphics)
+    {
+        Defer([holder = MakeShared<std::decay_t<T>>(std::forward<T>(resource))]() mutable { holder.reset(); }, queues);
+    }
+
+    /** 执行已经可以执行的延迟销毁 */
+    void Collect();
+
+    /**
+     * @brief 等待所有队列完成并执行所有延迟销毁
+     * @note 不会等待还没提交的工作，调用者需要保证没有未提交的命令缓冲区引用延迟销毁的资源
+     */
+    void WaitIdle();
+
+    /** 等待执行的延迟销毁数量 */
+    size_t GetDeferredCount() const;
+
+private:
+    struct Deferred
+    {
+        Array<u64, QueueCount> Values {};   ///< 每个队列需要完成的值
+        Function<void()> Destroy;
+    };
+
+    // 登记时的值是否已经全部完成
+    bool IsComplete(const Deferred& deferred) const;
+
+private:
+    VkDevice m_Device {VK_NULL_HANDLE};                         ///< 逻辑设备
+    Array<UniquePtr<VulkanTimeline>, QueueCount> m_Timelines;   ///< 每个队列的时间线，未注册的为空
+    Deque<Deferred> m_Deferred;                                 ///< 按登记顺序排列的延迟销毁
+    mutable std::mutex m_DeferredMutex;                         ///< 保护m_Deferred
+};
@@ -0,0 +1,348 @@
+﻿#include "VulkanStagingRing.h"
+
+#include "VulkanScheduler.h"
+#include "VulkanUtils.h"
+
+VulkanStagingRing::~VulkanStagingRing()
+{
+    Destroy();
+}
+
+void VulkanStagingRing::Create(const VulkanAllocator& allocator, const VkQueue queue, const u32 queueFamily, const VkDeviceSize capacity)
+{
+    Destroy();
+    m_Allocator = &allocator;
+    m_Device    = allocator.GetDevice();
+    m_Queue     = queue;
+    m_Buffer    = VulkanBuffer(allocator, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VulkanMemoryUsage::Upload);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+    VK_CHECK(vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_CommandPool));
+}
+
+void VulkanStagingRing::Destroy()
+{
+    if (m_Device == VK_NULL_HANDLE)
+        return;
+
+    WaitIdle();
+
+    std::lock_guard lock(m_Mutex);
+    for (const Batch& batch : m_FreeBatches)
+    {
+        vkDestroyFence(m_Device, batch.Fence, nullptr);
+    }
+    m_FreeBatches.clear();
+    vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+    m_Buffer.Destroy();
+
+    m_CommandPool = VK_NULL_HANDLE;
+    m_Queue       = VK_NULL_HANDLE;
+    m_Timeline    = nullptr;
+    m_Device      = VK_NULL_HANDLE;
+    m_Allocator   = nullptr;
+    m_Head        = 0;
+    m_Used        = 0;
+}
+
+void VulkanStagingRing::SetTimeline(VulkanTimeline* timeline)
+{
+    std::lock_guard lock(m_Mutex);
+    PL_ASSERT(m_InFlight.empty(), "Timeline must be set before the first submit");
+    PL_ASSERT(!timeline || timeline->GetQueue() == m_Queue, "Timeline belongs to another queue");
+    m_Timeline = timeline;
+}
+
+void VulkanStagingRing::UploadBuffer(const VulkanBuffer& dst, const void* data, const VkDeviceSize size, const VkDeviceSize offset)
+{
+    PL_ASSERT(offset + size <= dst.GetSize(), "Upload out of buffer range");
+    if (size == 0)
+        return;
+
+    std::lock_guard lock(m_Mutex);
+    const auto [src, srcOffset] = StageLocked(data, size);
+
+    BufferCopy& copy = m_BufferCopies.emplace_back();
+    copy.Src              = src;
+    copy.Dst              = dst.GetHandle();
+    copy.Region.srcOffset = srcOffset;
+    copy.Region.dstOffset = offset;
+    copy.Region.size      = size;
+}
+
+void VulkanStagingRing::UploadImage(const VulkanImage& dst, const void* data, const VkDeviceSize size, const u32 mipLevel, const VkImageLayout finalLayout)
+{
+    const VulkanImageDesc& desc = dst.GetDesc();
+    PL_ASSERT(mipLevel < desc.MipLevels, "Upload mip level out of range");
+    if (size == 0)
+        return;
+
+    const VkExtent3D extent = {std::max(desc.Extent.width >> mipLevel, 1u), std::max(desc.Extent.height >> mipLevel, 1u), 1};
+    // 拷贝会读取整个mip层级的所有数组层，数据不足时会越界读取暂存缓冲区
+    const u32 texelSize = VulkanImage::GetTexelSize(desc.Format);
+    PL_ASSERT(texelSize == 0 || size >= static_cast<VkDeviceSize>(extent.width) * extent.height * desc.ArrayLayers * texelSize,
+              "Upload size does not cover the image region");
+
+    std::lock_guard lock(m_Mutex);
+    const auto [src, srcOffset] = StageLocked(data, size);
+
+    ImageCopy& copy = m_ImageCopies.emplace_back();
+    copy.Src         = src;
+    copy.Dst         = dst.GetHandle();
+    copy.FinalLayout = finalLayout;
+
+    copy.Region.bufferOffset                    = srcOffset;
+    copy.Region.imageSubresource.aspectMask     = desc.Aspect;
+    copy.Region.imageSubresource.mipLevel       = mipLevel;
+    copy.Region.imageSubresource.baseArrayLayer = 0;
+    copy.Region.imageSubresource.layerCount     = desc.ArrayLayers;
+    copy.Region.imageExtent                     = extent;
+
+    copy.Range.aspectMask     = desc.Aspect;
+    copy.Range.baseMipLevel   = mipLevel;
+    copy.Range.levelCount     = 1;
+    copy.Range.baseArrayLayer = 0;
+    copy.Range.layerCount     = desc.ArrayLayers;
+}
+
+void VulkanStagingRing::Submit()
+{
+    std::lock_guard lock(m_Mutex);
+    SubmitLocked();
+}
+
+void VulkanStagingRing::Reclaim()
+{
+    std::lock_guard lock(m_Mutex);
+    ReclaimLocked(false);
+}
+
+void VulkanStagingRing::WaitIdle()
+{
+    std::lock_guard lock(m_Mutex);
+    SubmitLocked();
+    while (!m_InFlight.empty())
+    {
+        ReclaimLocked(true);
+    }
+}
+
+VkDeviceSize VulkanStagingRing::GetUsedSize() const
+{
+    std::lock_guard lock(m_Mutex);
+    return m_Used;
+}
+
+std::pair<VkBuffer, VkDeviceSize> VulkanStagingRing::StageLocked(const void* data, const VkDeviceSize size)
+{
+    PL_ASSERT(m_Device != VK_NULL_HANDLE, "Staging ring is not created");
+
+    // 上传可能来自任意线程，这里不能向队列提交，也不阻塞等待
+    // 先回收已经完成的批次，仍然放不下时和超大的上传一样使用临时缓冲区，随批次释放
+    VkDeviceSize offset {0};
+    if (size <= m_Buffer.GetSize() / 2)
+    {
+        if (AllocateLocked(size, offset))
+        {
+            m_Buffer.Write(data, size, offset);
+            return {m_Buffer.GetHandle(), offset};
+        }
+        ReclaimLocked(false);
+        if (AllocateLocked(size, offset))
+        {
+            m_Buffer.Write(data, size, offset);
+            return {m_Buffer.GetHandle(), offset};
+        }
+    }
+
+    VulkanBuffer& temporary = m_Current.Temporaries.emplace_back(*m_Allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VulkanMemoryUsage::Upload);
+    temporary.Write(data, size);
+    return {temporary.GetHandle(), 0};
+}
+
+bool VulkanStagingRing::AllocateLocked(const VkDeviceSize size, VkDeviceSize& outOffset)
+{
+    const VkDeviceSize capacity = m_Buffer.GetSize();
+    VkDeviceSize offset = AlignUp(m_Head, Alignment);
+    VkDeviceSize needed = offset - m_Head + size;
+
+    // 尾部放不下时回绕到开头，尾部剩余的空间算作浪费
+    if (offset + size > capacity)
+    {
+        offset = 0;
+        needed = capacity - m_Head + size;
+    }
+
+    if (m_Used + needed > capacity)
+        return false;
+
+    m_Head          = offset + size;
+    m_Used         += needed;
+    m_Current.Bytes += needed;
+    outOffset       = offset;
+    return true;
+}
+
+void VulkanStagingRing::SubmitLocked()
+{
+    if (m_BufferCopies.empty() && m_ImageCopies.empty())
+        return;
+
+    Batch batch = AcquireBatchLocked();
+    batch.Bytes       = std::exchange(m_Current.Bytes, 0);
+    batch.Temporaries = std::move(m_Current.Temporaries);
+    m_Current.Temporaries.clear();
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(batch.CommandBuffer, &beginInfo));
+
+    // 相同源和目标的拷贝合并为一次vkCmdCopyBuffer
+    std::ranges::stable_sort(m_BufferCopies, [](const BufferCopy& a, const BufferCopy& b) {
+        return std::tie(a.Dst, a.Src) < std::tie(b.Dst, b.Src);
+    });
+    Vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < m_BufferCopies.size();)
+    {
+        regions.clear();
+        const BufferCopy& first = m_BufferCopies[i];
+        for (; i < m_BufferCopies.size() && m_BufferCopies[i].Dst == first.Dst && m_BufferCopies[i].Src == first.Src; ++i)
+        {
+            regions.push_back(m_BufferCopies[i].Region);
+        }
+        vkCmdCopyBuffer(batch.CommandBuffer, first.Src, first.Dst, static_cast<u32>(regions.size()), regions.data());
+    }
+
+    if (!m_ImageCopies.empty())
+    {
+        Vector<VkImageMemoryBarrier> barriers(m_ImageCopies.size());
+        for (size_t i = 0; i < m_ImageCopies.size(); ++i)
+        {
+            VkImageMemoryBarrier& barrier = barriers[i];
+            barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask       = 0;
+            barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image               = m_ImageCopies[i].Dst;
+            barrier.subresourceRange    = m_ImageCopies[i].Range;
+        }
+        // 重新上传的图像可能仍被之前提交的命令读取，读后写只需执行依赖，等待所有阶段完成后才能覆盖
+        vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, static_cast<u32>(barriers.size()), barriers.data());
+
+        for (const ImageCopy& copy : m_ImageCopies)
+        {
+            vkCmdCopyBufferToImage(batch.CommandBuffer, copy.Src, copy.Dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.Region);
+        }
+
+        for (size_t i = 0; i < m_ImageCopies.size(); ++i)
+        {
+            VkImageMemoryBarrier& barrier = barriers[i];
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout     = m_ImageCopies[i].FinalLayout;
+        }
+        vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0, 0, nullptr, 0, nullptr, static_cast<u32>(barriers.size()), barriers.data());
+    }
+
+    // 让同一队列上之后提交的读取看到缓冲区拷贝的结果
+    VkMemoryBarrier memoryBarrier {};
+    memoryBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+                                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    VK_CHECK(vkEndCommandBuffer(batch.CommandBuffer));
+
+    if (m_Timeline)
+    {
+        batch.Value = m_Timeline->Submit(Span<const VkCommandBuffer>(&batch.CommandBuffer, 1));
+    }
+    else
+    {
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &batch.CommandBuffer;
+        VK_CHECK(vkQueueSubmit(m_Queue, 1, &submitInfo, batch.Fence));
+    }
+
+    m_BufferCopies.clear();
+    m_ImageCopies.clear();
+    m_InFlight.push_back(std::move(batch));
+}
+
+void VulkanStagingRing::ReclaimLocked(bool wait)
+{
+    while (!m_InFlight.empty())
+    {
+        Batch& batch = m_InFlight.front();
+        if (!IsBatchComplete(batch, wait))
+            break;
+        wait = false;
+
+        m_Used -= batch.Bytes;
+        batch.Bytes = 0;
+        batch.Temporaries.clear();
+        m_FreeBatches.push_back(std::move(batch));
+        m_InFlight.pop_front();
+    }
+
+    // 没有任何占用时从头开始，减少回绕浪费
+    if (m_Used == 0 && m_Current.Bytes == 0)
+        m_Head = 0;
+}
+
+VulkanStagingRing::Batch VulkanStagingRing::AcquireBatchLocked()
+{
+    if (!m_FreeBatches.empty())
+    {
+        Batch batch = std::move(m_FreeBatches.back());
+        m_FreeBatches.pop_back();
+        if (batch.Fence != VK_NULL_HANDLE)
+            VK_CHECK(vkResetFences(m_Device, 1, &batch.Fence));
+        VK_CHECK(vkResetCommandBuffer(batch.CommandBuffer, 0));
+        return batch;
+    }
+
+    Batch batch;
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool        = m_CommandPool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VK_CHECK(vkAllocateCommandBuffers(m_Device, &allocInfo, &batch.CommandBuffer));
+
+    // 有时间线时不需要栅栏
+    if (!m_Timeline)
+    {
+        VkFenceCreateInfo fenceInfo {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VK_CHECK(vkCreateFence(m_Device, &fenceInfo, nullptr, &batch.Fence));
+    }
+    return batch;
+}
+
+bool VulkanStagingRing::IsBatchComplete(const Batch& batch, const bool wait) const
+{
+    if (m_Timeline)
+        return wait ? m_Timeline->Wait(batch.Value) : m_Timeline->IsComplete(batch.Value);
+
+    if (wait)
+    {
+        VK_CHECK(vkWaitForFences(m_Device, 1, &batch.Fence, VK_TRUE, UINT64_MAX));
+        return true;
+    }
+    return vkGetFenceStatus(m_Device, batch.Fence) == VK_SUCCESS;
+}
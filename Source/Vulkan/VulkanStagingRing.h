@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <mutex>
+
+#include "Core/BaseType.h"
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+
+class VulkanTimeline;
+
+/**
+ * @class VulkanStagingRing
+ * @brief 把数据上传到设备本地资源的暂存环形缓冲区
+ * @details
+ * 一块持久映射的Upload缓冲区按环形分配，Upload时立即写入映射内存，只记录拷贝 \n
+ * Submit把积累的所有拷贝录制到一个命令缓冲区中一次提交，每批带一个栅栏，栅栏触发后回收该批占用的空间 \n
+ * 批次末尾的屏障让之后在同一队列上提交的顶点、索引、uniform和着色器读取都能看到拷贝结果 \n
+ * 空间不足时先回收已完成的批次，仍然不足或者上传超过一半容量时使用临时缓冲区 \n
+ * 设置了时间线时批次用时间线值判断完成，不再为每个批次创建栅栏 \n
+ * 不做队列族所有权转移，目标资源需要由同一队列族使用，或者以CONCURRENT模式创建 \n
+ * Upload和Reclaim可以在任意线程调用，不会向队列提交 \n
+ * Submit、WaitIdle和Destroy会向队列提交，Vulkan要求同一队列的访问外部同步， \n
+ * 只能在负责该队列提交和呈现的线程(通常是渲染线程)中调用
+ */
+class VulkanStagingRing
+{
+public:
+    static constexpr VkDeviceSize DefaultCapacity = 32ull << 20;
+
+    VulkanStagingRing() = default;
+    ~VulkanStagingRing();
+
+    VulkanStagingRing(const VulkanStagingRing&) = delete;
+    VulkanStagingRing& operator=(const VulkanStagingRing&) = delete;
+
+    /** 创建环形缓冲区，queue需要支持传输操作 */
+    void Create(const VulkanAllocator& allocator, VkQueue queue, u32 queueFamily, VkDeviceSize capacity = DefaultCapacity);
+
+    /** 等待所有批次完成并销毁，需要在销毁分配器前调用 */
+    void Destroy();
+
+    /** 通过queue的时间线提交，需要在第一次提交前设置 */
+    void SetTimeline(VulkanTimeline* timeline);
+
+    /** 上传到缓冲区的[offset, offset + size) */
+    void UploadBuffer(const VulkanBuffer& dst, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+    /**
+     * @brief 上传图像的一个mip层级的所有数组层
+     * @details 数据按层紧密排列，size至少为该mip层级的宽×高×数组层数×像素大小，拷贝前图像转换到TRANSFER_DST，拷贝后转换到finalLayout
+     */
+    void UploadImage(const VulkanImage& dst, const void* data, VkDeviceSize size, u32 mipLevel = 0,
+                     VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    /** 提交积累的拷贝，没有拷贝时直接返回，一般每帧在提交渲染命令前由渲染线程调用一次 */
+    void Submit();
+
+    /** 回收已经完成的批次 */
+    void Reclaim();
+
+    /** 提交并等待所有批次完成 */
+    void WaitIdle();
+
+    /** 当前被未完成批次占用的字节数 */
+    VkDeviceSize GetUsedSize() const;
+
+private:
+    // 一次提交
+    struct Batch
+    {
+        VkCommandBuffer CommandBuffer {VK_NULL_HANDLE};
+        VkFence Fence {VK_NULL_HANDLE};     ///< 没有时间线时使用
+        u64 Value {0};                      ///< 时间线上的提交值
+        VkDeviceSize Bytes {0};             ///< 占用的环形缓冲区字节数，包括对齐和回绕浪费的部分
+        Vector<VulkanBuffer> Temporaries;   ///< 超过容量的上传使用的临时缓冲区
+    };
+
+    struct BufferCopy
+    {
+        VkBuffer Src {VK_NULL_HANDLE};
+        VkBuffer Dst {VK_NULL_HANDLE};
+        VkBufferCopy Region {};
+    };
+
+    struct ImageCopy
+    {
+        VkBuffer Src {VK_NULL_HANDLE};
+        VkImage Dst {VK_NULL_HANDLE};
+        VkBufferImageCopy Region {};
+        VkImageSubresourceRange Range {};
+        VkImageLayout FinalLayout {VK_IMAGE_LAYOUT_UNDEFINED};
+    };
+
+    // 写入暂存数据，返回源缓冲区和偏移，需要持有锁
+    std::pair<VkBuffer, VkDeviceSize> StageLocked(const void* data, VkDeviceSize size);
+
+    // 在环形缓冲区中分配，空间不足时返回false
+    bool AllocateLocked(VkDeviceSize size, VkDeviceSize& outOffset);
+
+    // 提交当前批次，需要持有锁
+    void SubmitLocked();
+
+    // 回收完成的批次，wait为true时至少等待最早的一个批次
+    void ReclaimLocked(bool wait);
+
+    // 取一个空闲的命令缓冲区和栅栏
+    Batch AcquireBatchLocked();
+
+    // 批次是否完成，wait为true时等待完成
+    bool IsBatchComplete(const Batch& batch, bool wait) const;
+
+private:
+    static constexpr VkDeviceSize Alignment = 16;   ///< 拷贝源偏移的对齐，满足缓冲区拷贝和常见纹理格式的要求
+
+    const VulkanAllocator* m_Allocator {nullptr};   ///< 分配器
+    VkDevice m_Device {VK_NULL_HANDLE};             ///< 逻辑设备
+    VkQueue m_Queue {VK_NULL_HANDLE};               ///< 提交队列
+    VulkanTimeline* m_Timeline {nullptr};           ///< 提交队列的时间线，可以为空
+    VkCommandPool m_CommandPool {VK_NULL_HANDLE};   ///< 命令池
+    VulkanBuffer m_Buffer;                          ///< 持久映射的暂存缓冲区
+
+    VkDeviceSize m_Head {0};                        ///< 下一次分配的起始位置
+    VkDeviceSize m_Used {0};                        ///< 未完成批次和当前批次占用的字节数
+    Batch m_Current;                                ///< 正在积累的批次
+    Vector<BufferCopy> m_BufferCopies;              ///< 当前批次的缓冲区拷贝
+    Vector<ImageCopy> m_ImageCopies;                ///< 当前批次的图像拷贝
+    Deque<Batch> m_InFlight;                        ///< 按提交顺序排列的未完成批次
+    Vector<Batch> m_FreeBatches;                    ///< 可以复用的命令缓冲区和栅栏
+    mutable std::mutex m_Mutex;                     ///< 保护以上数据
+};
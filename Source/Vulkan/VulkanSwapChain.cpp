@@ -122,6 +122,15 @@ VkResult VulkanSwapChain::AcquireNextImage(u32* imageIndex, VkSemaphore signalSe
     return result;
 }
 
+VkResult VulkanSwapChain::AcquireNextImage(u32* imageIndex, VulkanFrameRing& frames) {
+    VkResult result = AcquireNextImage(imageIndex, frames.GetCurrentFrame().ImageAvailable);
+    if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+        frames.BindImage(*imageIndex);
+    }
+
+    return result;
+}
+
 VkResult VulkanSwapChain::GetCurrentImageIndex(u32* imageIndex) {
     *imageIndex = currentImageIndex;
     return VK_SUCCESS;
@@ -142,6 +151,10 @@ VkResult VulkanSwapChain::PresentImage(u32 imageIndex, VkSemaphore* waitSemaphor
     return vkQueuePresentKHR(context->GetPresentQueue(), &presentInfo);
 }
 
+VkResult VulkanSwapChain::PresentImage(u32 imageIndex, VulkanFrameRing& frames) {
+    return PresentImage(imageIndex, &frames.GetCurrentFrame().RenderFinished, 1);
+}
+
 VkSurfaceFormatKHR VulkanSwapChain::ChooseSwapSurfaceFormat(const DynamicArray<VkSurfaceFormatKHR>& availableFormats) {
     // 寻找首选格式
     for (const auto& availableFormat : availableFormats) {
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Core/BaseType.h"
 #include "VulkanContext.h"
+#include "VulkanFrameRing.h"
 
     class VulkanSwapChain {
     public:
@@ -23,12 +24,18 @@
         // 获取下一个图像
         VkResult AcquireNextImage(u32* imageIndex, VkSemaphore signalSemaphore);
 
+        // 用帧环当前帧的信号量获取下一个图像，并等待仍在使用该图像的帧
+        VkResult AcquireNextImage(u32* imageIndex, VulkanFrameRing& frames);
+
         // 获取当前图像索引
         VkResult GetCurrentImageIndex(u32* imageIndex);
 
         // 显示图像
         VkResult PresentImage(u32 imageIndex, VkSemaphore* waitSemaphores, u32 waitSemaphoreCount);
 
+        // 等待帧环当前帧渲染完成后显示图像
+        VkResult PresentImage(u32 imageIndex, VulkanFrameRing& frames);
+
         // 获取访问器
         VkFormat GetImageFormat() const { return imageFormat; }
         VkExtent2D GetExtent() const { return extent; }
@@ -29,6 +29,12 @@ elseif is_plat("macosx") then
     add_defines("PL_PLAT_MACOSX")
     add_defines("PL_WORK_DIR=\"" .. projectdir .. "\"")
 end
+option("shader_compiler")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Link shaderc into samples; disable to load shaders only from the ShaderBaker archive")
+option_end()
+
 --lib--
 add_requires("spdlog >= 1.15.0", "glm", "glfw >= 3.3.8", "shaderc", "spirv-cross")
 
@@ -40,6 +46,7 @@ local includedirs =
 }
 
 local Deps = { "spdlog", "glm", "glfw","shaderc", "spirv-cross" }
+local RuntimeDeps = { "spdlog", "glm", "glfw", "spirv-cross" }
 
 local sample_dirs = os.dirs("Source/Samples/*")
 
@@ -66,16 +73,43 @@ for _, sampledir in ipairs(sample_dirs) do
     target(target_name)
         set_kind("binary")
         add_includedirs(includedirs)
-        add_packages(Deps)
         set_pcxxheader("Source/Vulkan/vkpch.h")
         add_headerfiles(head_files)
         add_files(source_files)
         add_headerfiles("Source/Vulkan/**.h")
         add_files("Source/Vulkan/**.cpp")
         add_defines("TARGET_NAME = " .. target_name)
+        if has_config("shader_compiler") then
+            add_packages(Deps)
+        else
+            add_packages(RuntimeDeps)
+            add_defines("PL_SHADER_NO_COMPILER")
+            remove_files("Source/Vulkan/Shader/ShaderCompiler.cpp", "Source/Vulkan/Shader/ShaderDependency.cpp")
+        end
 
 end
 
+--tools--
+target("ShaderBenchmark")
+    set_kind("binary")
+    add_includedirs(includedirs)
+    add_packages(Deps)
+    set_pcxxheader("Source/Vulkan/vkpch.h")
+    add_files("Source/Tools/ShaderBenchmark/**.cpp")
+    add_headerfiles("Source/Vulkan/Core/**.h", "Source/Vulkan/Shader/**.h")
+    add_files("Source/Vulkan/Core/**.cpp", "Source/Vulkan/Shader/**.cpp")
+    add_defines("TARGET_NAME = ShaderBenchmark")
+
+target("ShaderBaker")
+    set_kind("binary")
+    add_includedirs(includedirs)
+    add_packages(Deps)
+    set_pcxxheader("Source/Vulkan/vkpch.h")
+    add_files("Source/Tools/ShaderBaker/**.cpp")
+    add_headerfiles("Source/Vulkan/Core/**.h", "Source/Vulkan/Shader/**.h")
+    add_files("Source/Vulkan/Core/**.cpp", "Source/Vulkan/Shader/**.cpp")
+    add_defines("TARGET_NAME = ShaderBaker")
+
 --target("VulkanRenderer")
 --    set_kind("binary")
 --    add_includedirs(includedirs)